@@ -1,6 +1,53 @@
 #!/bin/bash
 
-FILES="src/main.c"
+set -e
+
+CFLAGS="-Wall -Werror"
 RAYLIB="-I./raylib-5.5/include -L./raylib-5.5/lib/ -l:libraylib.a"
 
-gcc -Wall -Werror $FILES -o main $RAYLIB -lm
+# panel simulation, it doesn't need raylib
+LIB_FILES="src/panel.c src/ai.c src/rng.c src/replay.c src/replay_archive.c src/panel_set.c src/thread_pool.c src/CCFuncs.c src/transposition.c src/transport.c src/netplay.c"
+
+build_game() {
+    gcc $CFLAGS src/main.c src/render.c $LIB_FILES -o main $RAYLIB -lm -lpthread
+}
+
+# builds build/libpanel.a, a headless static library of the simulation without the profiler zones
+build_lib() {
+    mkdir -p build
+    OBJS=""
+    for f in $LIB_FILES; do
+        obj="build/$(basename ${f%.c}).o"
+        gcc $CFLAGS -O2 -DCCFUNCS_NO_PROFILER -c $f -o $obj
+        OBJS="$OBJS $obj"
+    done
+    ar rcs build/libpanel.a $OBJS
+}
+
+# builds build/bench, a headless benchmark of the simulation kernels
+build_bench() {
+    build_lib
+    gcc $CFLAGS -O2 -DCCFUNCS_NO_PROFILER src/bench.c build/libpanel.a -o build/bench -lm -lpthread
+}
+
+# builds build/replay, a headless replay player
+build_replay() {
+    build_lib
+    gcc $CFLAGS -O2 -DCCFUNCS_NO_PROFILER src/replay_main.c build/libpanel.a -o build/replay -lpthread
+}
+
+# builds build/netplay, a headless versus game between two rollback sessions
+build_netplay() {
+    build_lib
+    gcc $CFLAGS -O2 -DCCFUNCS_NO_PROFILER src/netplay_main.c build/libpanel.a -o build/netplay -lpthread
+}
+
+case "$1" in
+    ""|game) build_game ;;
+    lib) build_lib ;;
+    bench) build_bench ;;
+    replay) build_replay ;;
+    netplay) build_netplay ;;
+    all) build_game; build_bench; build_replay; build_netplay ;;
+    *) echo "usage: $0 [game|lib|bench|replay|netplay|all]"; exit 1 ;;
+esac
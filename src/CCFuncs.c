@@ -0,0 +1,2 @@
+#define CCFUNCS_IMPLEMENTATION
+#include "CCFuncs.h"
@@ -5,7 +5,11 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
 
 // DYNAMIC ARRAY //
 
@@ -44,6 +48,48 @@
 
 // printf like function that prints the name and line of the file where it was called
 #define log_error(msg, ...) _log_error(msg, __FILE__, __LINE__, __VA_ARGS__);
+void _log_error(const char *msg, char *file, int line, ...);
+
+// PROFILER //
+
+// measures the time spent between PROFILE_BEGIN and PROFILE_END of a zone, the time of every zone is accumulated
+// during a frame and saved in a ring buffer of the last PROFILER_HISTORY frames when profiler_end_frame is called.
+// NOTE: the profiler state is per thread, define CCFUNCS_NO_PROFILER to compile the zones out
+#ifndef CCFUNCS_NO_PROFILER
+#define PROFILE_BEGIN(zone) uint64_t _profile_start_##zone = profiler_now();
+#define PROFILE_END(zone) profiler_record(#zone, profiler_now() - _profile_start_##zone);
+#else
+#define PROFILE_BEGIN(zone)
+#define PROFILE_END(zone)
+#endif
+
+#define PROFILER_MAX_ZONES 16
+#define PROFILER_HISTORY 256 // frames saved per zone
+
+typedef struct {
+    const char *name;
+    uint64_t frameNs; // time of the current frame
+    uint64_t history[PROFILER_HISTORY]; // time of the last frames, indexed by frame % PROFILER_HISTORY
+} ProfileZone;
+
+typedef struct {
+    ProfileZone zones[PROFILER_MAX_ZONES];
+    size_t zoneCount;
+    size_t frames; // frames ended
+} Profiler;
+
+typedef struct {
+    const char *name;
+    double minMs;
+    double avgMs;
+    double p99Ms;
+} ProfileStats;
+
+uint64_t profiler_now(void); // monotonic time in nanoseconds
+void profiler_record(const char *zone, uint64_t ns);
+void profiler_end_frame(void);
+// fills stats with the stats of up to maxZones zones over the saved frames and returns the number of zones
+size_t profiler_get_stats(ProfileStats *stats, size_t maxZones);
 
 // STRING BUILDER //
 
@@ -56,16 +102,30 @@ typedef struct {
 // dumps a null terminated string
 char *sb_dump_str(StringBuilder *sb);
 
+// LITTLE ENDIAN //
+
+// reads and writes integers in little endian no matter the byte order of the machine, used by the file formats and
+// packets
+void le_put_u32(uint8_t *data, uint32_t n);
+void le_put_u64(uint8_t *data, uint64_t n);
+uint32_t le_get_u32(const uint8_t *data);
+uint64_t le_get_u64(const uint8_t *data);
+
 // ARENA //
 typedef struct Region Region;
 
 struct Region {
     void *data;
     size_t count;
-    size_t capacity;
+    size_t capacity; // regionSize, or more for a region made for an allocation bigger than regionSize
+    size_t idleClears; // arena_clear calls since the region was used
+    size_t overflowSize; // size of the allocation that didn't fit in the tail of the region, 0 if none
 };
 
 // Arena is basically a dynamic array of Regions
+// NOTE: the regions from 0 to regionIndex are the ones in use, the empty ones after them are kept for the next
+// allocations and they are only freed after ARENA_MAX_IDLE_CLEARS clears without being used, so the memory of the
+// arena follows the peak of its recent working set
 typedef struct {
     Region *items;
     size_t count;
@@ -73,13 +133,57 @@ typedef struct {
 
     size_t regionSize;
     size_t regionIndex;
+    size_t regionsUsed; // regions used since the last clear
+
+    size_t usedBytes; // allocated bytes, including the alignment padding
+    size_t peakBytes; // most used bytes since the last clear
+    size_t highWaterBytes; // most used bytes before the last clear
 } Arena;
 
+// position of the arena at some point, everything allocated after it can be released with arena_reset_to
+typedef struct {
+    size_t regionIndex;
+    size_t count;
+} ArenaMark;
+
+// usage of an arena to choose its regionSize, see arena_stats
+typedef struct {
+    size_t usedBytes;
+    size_t peakBytes; // since the last clear
+    size_t highWaterBytes; // since the arena was created
+    size_t wastedBytes; // unused tail of the regions before the current one, left when an allocation didn't fit
+    size_t reservedBytes; // capacity of every region, in use or not
+    size_t regionsInUse;
+    size_t regionCount;
+} ArenaStats;
+
+// usage of a single region of an arena, see arena_region_stats
+typedef struct {
+    size_t capacity;
+    size_t usedBytes;
+    size_t wastedBytes; // unused tail left because overflowSize didn't fit, only before the current region
+    size_t overflowSize; // size of the allocation that moved the arena to the next region, 0 if none
+    bool inUse;
+} RegionStats;
+
+#define ARENA_REGION_ALIGN 64 // the headers and regions start at a cache line so the arenas of different threads never share one
+#define ARENA_DEFAULT_ALIGN _Alignof(max_align_t)
+#define ARENA_MAX_IDLE_CLEARS 60
+
 Arena *arena_create(size_t regionSize);
-void *arena_alloc(Arena *arena, size_t size);
-void arena_clear(Arena *arena); // clears the arena (NOTE: no region or allocation is freed)
+void *arena_alloc(Arena *arena, size_t size); // aligned to ARENA_DEFAULT_ALIGN
+// align must be a power of two up to ARENA_REGION_ALIGN
+void *arena_alloc_aligned(Arena *arena, size_t size, size_t align);
+void arena_clear(Arena *arena); // clears the arena, only the regions idle for too long are freed
 void arena_free(Arena *arena);
 
+ArenaMark arena_mark(Arena *arena);
+// releases the allocations made after mark, the marks have to be reset in the inverse order they were taken
+void arena_reset_to(Arena *arena, ArenaMark mark);
+
+ArenaStats arena_stats(Arena *arena);
+RegionStats arena_region_stats(Arena *arena, size_t index); // index has to be less than the regionCount of the stats
+
 #endif // CCFUNCS_H
 
 #ifdef CCFUNCS_IMPLEMENTATION
@@ -95,6 +199,71 @@ void _log_error(const char *msg, char *file, int line, ...) {
     printf(" (at %s:%d)\n", file, line);
 }
 
+static _Thread_local Profiler profiler;
+
+uint64_t profiler_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void profiler_record(const char *zone, uint64_t ns) {
+    for(size_t i = 0; i < profiler.zoneCount; i++) {
+        ProfileZone *z = &profiler.zones[i];
+        if(z->name == zone || strcmp(z->name, zone) == 0) {
+            z->frameNs += ns;
+            return;
+        }
+    }
+
+    if(profiler.zoneCount >= PROFILER_MAX_ZONES) return;
+
+    // the zone was never recorded before, the previous frames count as zero
+    ProfileZone *z = &profiler.zones[profiler.zoneCount++];
+    z->name = zone;
+    z->frameNs = ns;
+}
+
+void profiler_end_frame(void) {
+    for(size_t i = 0; i < profiler.zoneCount; i++) {
+        ProfileZone *z = &profiler.zones[i];
+        z->history[profiler.frames % PROFILER_HISTORY] = z->frameNs;
+        z->frameNs = 0;
+    }
+    profiler.frames++;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+size_t profiler_get_stats(ProfileStats *stats, size_t maxZones) {
+    size_t samples = profiler.frames < PROFILER_HISTORY ? profiler.frames : PROFILER_HISTORY;
+    size_t count = profiler.zoneCount < maxZones ? profiler.zoneCount : maxZones;
+    if(samples == 0) return 0;
+
+    uint64_t sorted[PROFILER_HISTORY];
+    for(size_t i = 0; i < count; i++) {
+        ProfileZone *z = &profiler.zones[i];
+
+        memcpy(sorted, z->history, samples * sizeof(uint64_t));
+        qsort(sorted, samples, sizeof(uint64_t), compare_u64);
+
+        uint64_t sum = 0;
+        for(size_t j = 0; j < samples; j++) sum += sorted[j];
+
+        stats[i] = (ProfileStats) {
+            .name = z->name,
+            .minMs = sorted[0] / 1e6,
+            .avgMs = sum / (double)samples / 1e6,
+            .p99Ms = sorted[(samples - 1) * 99 / 100] / 1e6,
+        };
+    }
+
+    return count;
+}
+
 char *sb_dump_str(StringBuilder *sb) {
     char *str = malloc(sb->count + 1);
     strncpy(str, sb->items, sb->count);
@@ -102,48 +271,126 @@ char *sb_dump_str(StringBuilder *sb) {
     return str;
 }
 
+void le_put_u32(uint8_t *data, uint32_t n) {
+    for(int i = 0; i < 4; i++) data[i] = n >> (i * 8);
+}
+
+void le_put_u64(uint8_t *data, uint64_t n) {
+    for(int i = 0; i < 8; i++) data[i] = n >> (i * 8);
+}
+
+uint32_t le_get_u32(const uint8_t *data) {
+    uint32_t n = 0;
+    for(int i = 0; i < 4; i++) n |= (uint32_t)data[i] << (i * 8);
+    return n;
+}
+
+uint64_t le_get_u64(const uint8_t *data) {
+    uint64_t n = 0;
+    for(int i = 0; i < 8; i++) n |= (uint64_t)data[i] << (i * 8);
+    return n;
+}
+
 Arena *arena_create(size_t regionSize) {
-    Arena *arena = calloc(1, sizeof(Arena));
+    // the header is written by every allocation, so like the regions it fills its own cache lines
+    size_t size = (sizeof(Arena) + ARENA_REGION_ALIGN - 1) & ~(size_t)(ARENA_REGION_ALIGN - 1);
+    Arena *arena = aligned_alloc(ARENA_REGION_ALIGN, size);
     assert(arena != NULL && "Not enough memory");
+    memset(arena, 0, size);
     arena->regionSize = regionSize;
     return arena;
 }
 
+static Region arena_new_region(Arena *arena, size_t size) {
+    // aligned_alloc needs a size multiple of the alignment
+    if(size < arena->regionSize) size = arena->regionSize;
+    size_t capacity = (size + ARENA_REGION_ALIGN - 1) & ~(size_t)(ARENA_REGION_ALIGN - 1);
+    Region region = {
+        .data = aligned_alloc(ARENA_REGION_ALIGN, capacity),
+        .capacity = capacity,
+    };
+    assert(region.data != NULL && "Not enough memory");
+    return region;
+}
+
+// padding needed to align the next allocation of the region
+static size_t region_padding(Region *region, size_t align) {
+    uintptr_t next = (uintptr_t)((char*)region->data + region->count);
+    return -next & (align - 1);
+}
+
 void *arena_alloc(Arena *arena, size_t size) {
-    assert(size <= arena->regionSize && "Size cannot be bigger than region size");
+    return arena_alloc_aligned(arena, size, ARENA_DEFAULT_ALIGN);
+}
 
-    if(arena->count == 0) {
-        da_append(arena, ((Region) {
-            .data = malloc(arena->regionSize),
-            .capacity = arena->regionSize,
-        }));
-    }
+// makes the first empty region with room for size the current one, a new region is added if there is none
+static Region *arena_next_region(Arena *arena, size_t size) {
+    size_t first = arena->regionIndex;
+    if(arena->count > 0 && arena->items[first].count > 0) first++;
 
-    Region *region = &arena->items[arena->regionIndex];
+    size_t i = first;
+    while(i < arena->count && arena->items[i].capacity < size) i++;
 
-    if(region->count + size > region->capacity) {
-        if(arena->regionIndex >= arena->count - 1) {
-            da_append(arena, ((Region) {
-                .data = malloc(arena->regionSize),
-                .capacity = arena->regionSize,
-            }));
-        }
+    if(i == arena->count) da_append(arena, arena_new_region(arena, size));
+
+    // the empty regions can be in any order, swapping them keeps the regions in use together
+    Region region = arena->items[i];
+    arena->items[i] = arena->items[first];
+    arena->items[first] = region;
+
+    arena->regionIndex = first;
+    return &arena->items[first];
+}
+
+void *arena_alloc_aligned(Arena *arena, size_t size, size_t align) {
+    assert((align & (align - 1)) == 0 && align <= ARENA_REGION_ALIGN && "Invalid alignment");
 
-        region = &arena->items[++arena->regionIndex];
+    Region *region = arena->count > 0 ? &arena->items[arena->regionIndex] : NULL;
+    size_t padding = region != NULL ? region_padding(region, align) : 0;
+
+    if(region == NULL || region->count + padding + size > region->capacity) {
+        // the tail left in the region is wasted because of this allocation
+        if(region != NULL && region->count > 0) region->overflowSize = size;
+
+        // a new region starts aligned
+        region = arena_next_region(arena, size);
+        padding = 0;
     }
 
-    void *mem = region->data + region->count;
-    region->count += size;
+    void *mem = (char*)region->data + region->count + padding;
+    region->count += padding + size;
+
+    // every allocation marks its region as used, even when the whole working set fits in the first region
+    if(arena->regionsUsed < arena->regionIndex + 1) arena->regionsUsed = arena->regionIndex + 1;
+
+    arena->usedBytes += padding + size;
+    if(arena->peakBytes < arena->usedBytes) arena->peakBytes = arena->usedBytes;
     return mem;
 }
 
 void arena_clear(Arena *arena) {
-    arena->regionIndex = 0;
-
-    // reset every region setting its count to 0
+    // reset every region setting its count to 0, the ones that weren't used for a while are freed
+    size_t kept = 0;
     for(size_t i = 0; i < arena->count; i++) {
-        arena->items[i].count = 0;
+        Region region = arena->items[i];
+        region.count = 0;
+        region.overflowSize = 0;
+        region.idleClears = i < arena->regionsUsed ? 0 : region.idleClears + 1;
+
+        if(region.idleClears > ARENA_MAX_IDLE_CLEARS) {
+            free(region.data);
+        } else {
+            arena->items[kept++] = region;
+        }
     }
+
+    arena->count = kept;
+    arena->regionIndex = 0;
+    arena->regionsUsed = 0;
+
+    if(arena->highWaterBytes < arena->peakBytes) arena->highWaterBytes = arena->peakBytes;
+    arena->usedBytes = 0;
+    arena->peakBytes = 0;
 }
 
 void arena_free(Arena *arena) {
@@ -155,4 +402,62 @@ void arena_free(Arena *arena) {
     free(arena);
 }
 
+ArenaMark arena_mark(Arena *arena) {
+    if(arena->count == 0) return (ArenaMark) {0};
+
+    return (ArenaMark) {
+        .regionIndex = arena->regionIndex,
+        .count = arena->items[arena->regionIndex].count,
+    };
+}
+
+void arena_reset_to(Arena *arena, ArenaMark mark) {
+    if(arena->count == 0) return;
+    assert(mark.regionIndex <= arena->regionIndex && "The mark is after the end of the arena");
+
+    // the regions used after the mark are empty again
+    for(size_t i = mark.regionIndex + 1; i <= arena->regionIndex; i++) {
+        arena->usedBytes -= arena->items[i].count;
+        arena->items[i].count = 0;
+        arena->items[i].overflowSize = 0;
+    }
+
+    arena->regionIndex = mark.regionIndex;
+    arena->usedBytes -= arena->items[mark.regionIndex].count - mark.count;
+    arena->items[mark.regionIndex].count = mark.count;
+    arena->items[mark.regionIndex].overflowSize = 0;
+}
+
+ArenaStats arena_stats(Arena *arena) {
+    ArenaStats stats = {
+        .usedBytes = arena->usedBytes,
+        .peakBytes = arena->peakBytes,
+        .highWaterBytes = arena->highWaterBytes > arena->peakBytes ? arena->highWaterBytes : arena->peakBytes,
+        .regionsInUse = arena->count > 0 ? arena->regionIndex + 1 : 0,
+        .regionCount = arena->count,
+    };
+
+    for(size_t i = 0; i < arena->count; i++) {
+        Region *region = &arena->items[i];
+        stats.reservedBytes += region->capacity;
+        if(i < arena->regionIndex) stats.wastedBytes += region->capacity - region->count;
+    }
+
+    return stats;
+}
+
+RegionStats arena_region_stats(Arena *arena, size_t index) {
+    assert(index < arena->count && "The region is out of bounds");
+
+    Region *region = &arena->items[index];
+    bool beforeCurrent = index < arena->regionIndex;
+    return (RegionStats) {
+        .capacity = region->capacity,
+        .usedBytes = region->count,
+        .wastedBytes = beforeCurrent ? region->capacity - region->count : 0,
+        .overflowSize = beforeCurrent ? region->overflowSize : 0,
+        .inUse = index <= arena->regionIndex,
+    };
+}
+
 #endif // CCFUNCS_IMPLEMENTATION
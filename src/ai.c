@@ -0,0 +1,310 @@
+#include <limits.h>
+#include <stdatomic.h>
+
+#include "CCFuncs.h"
+#include "ai.h"
+
+#define AI_ARENA_SIZE (16 * 1024)
+
+// scores of the simulated states
+#define SCORE_BLOCK 10 // every cleared block
+#define SCORE_COMBO 20 // every block of a combo after the third one
+#define SCORE_CHAIN 100 // every chain link after the first
+#define SCORE_PAIR 2 // every pair of touching blocks of the same type
+#define SCORE_HEIGHT 5 // every row of the highest column
+
+#define DISCOUNT_NUM 9 // the future moves are worth 9/10 of the current one
+#define DISCOUNT_DEN 10
+
+typedef struct {
+    Ai *ai;
+    AiMove moves[AI_MOVE_COUNT];
+    int scores[AI_MOVE_COUNT];
+    size_t moveCount;
+    PanelSnapshot *root;
+    int depth;
+    uint64_t deadline; // 0 means no deadline
+    atomic_bool aborted;
+} SearchJob;
+
+// the rows of snapshot->panel point to the ring buffer of the panel it was taken from, so the rows of the snapshot
+// are read instead
+static bool is_move_useful(PanelSnapshot *snapshot, AiMove move) {
+    int row = PANEL_ROWS - move.y - 1;
+    if(row >= snapshot->panel.rows.count) return false;
+
+    // swapping two blocks of the same type (or two holes) changes nothing
+    Row r = snapshot->rows[row];
+    return row_get_type(r, move.x) != row_get_type(r, move.x + 1);
+}
+
+static void apply_move(Panel *panel, AiMove move) {
+    panel->cursor.x = move.x;
+    panel->cursor.y = move.y;
+    swap_blocks(panel);
+}
+
+// simulates until nothing falls and nothing clears, returns the score of the clears
+static int resolve_panel(Panel *panel, Arena *arena) {
+    int score = 0;
+    ArenaMark mark = arena_mark(arena);
+
+    while(true) {
+        settle_panel(panel);
+
+        // the events of the previous clear aren't needed anymore
+        arena_reset_to(arena, mark);
+        update_combos(panel, arena);
+
+        // everything landed without clearing, so the next clear can't continue this chain
+        if(panel->events.count == 0) {
+            panel->chain = 0;
+            return score;
+        }
+
+        for(size_t i = 0; i < panel->events.count; i++) {
+            ComboEvent *event = &panel->events.items[i];
+            score += event->size * SCORE_BLOCK;
+            score += MAX((int)event->size - 3, 0) * SCORE_COMBO;
+            score += (event->chain - 1) * SCORE_CHAIN;
+        }
+    }
+}
+
+// score of a settled panel without more moves
+static int evaluate_panel(Panel *panel) {
+    int maxHeight = 0;
+    for(int col = 0; col < PANEL_COLS; col++) {
+        maxHeight = MAX(maxHeight, panel->heights[col]);
+    }
+
+    int pairs = 0;
+    for(int row = 0; row < panel->rows.count; row++) {
+        Row r = *panel_row(panel, row);
+        Row above = row + 1 < panel->rows.count ? *panel_row(panel, row + 1) : 0;
+
+        for(int col = 0; col < PANEL_COLS; col++) {
+            BlockType type = row_get_type(r, col);
+            if(type == BLOCK_NONE) continue;
+
+            if(col + 1 < PANEL_COLS && row_get_type(r, col + 1) == type) pairs++;
+            if(row_get_type(above, col) == type) pairs++;
+        }
+    }
+
+    return pairs * SCORE_PAIR - maxHeight * SCORE_HEIGHT;
+}
+
+static bool is_search_aborted(SearchJob *job) {
+    if(atomic_load_explicit(&job->aborted, memory_order_relaxed)) return true;
+
+    if(job->deadline != 0 && profiler_now() > job->deadline) {
+        atomic_store_explicit(&job->aborted, true, memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+// different swap orders often reach the same blocks, the chain is part of the state because it scores the next clears
+static uint64_t get_state_hash(Panel *panel) {
+    return panel->hash ^ (uint64_t)panel->chain * 0x9e3779b97f4a7c15ULL;
+}
+
+// returns the best value reachable from the state of the worker panel with depth moves more
+static int search(SearchJob *job, AiWorker *worker, int depth) {
+    Panel *panel = &worker->panel;
+    if(depth == 0 || is_search_aborted(job)) return evaluate_panel(panel);
+
+    uint64_t hash = get_state_hash(panel);
+    int cached;
+    if(transposition_table_probe(job->ai->table, hash, depth, &cached)) return cached;
+
+    // the snapshot lives until the search of this depth returns
+    ArenaMark mark = arena_mark(worker->arena);
+    PanelSnapshot *snapshot = panel_snapshot_arena(panel, worker->arena);
+
+    // every move is tried once to order them, only the best ones are searched deeper
+    AiMove moves[AI_MOVE_COUNT];
+    int scores[AI_MOVE_COUNT];
+    size_t count = 0;
+
+    for(int y = 0; y < PANEL_ROWS; y++) {
+        for(int x = 0; x < PANEL_COLS - 1; x++) {
+            AiMove move = {x, y};
+            if(!is_move_useful(snapshot, move)) continue;
+
+            panel_restore(panel, snapshot);
+            apply_move(panel, move);
+            moves[count] = move;
+            scores[count] = resolve_panel(panel, worker->arena) + evaluate_panel(panel);
+            count++;
+        }
+    }
+
+    // doing nothing is always possible
+    panel_restore(panel, snapshot);
+    int best = evaluate_panel(panel);
+
+    for(int beam = 0; beam < AI_BEAM_WIDTH && beam < count; beam++) {
+        // selection of the next best move, the beam is small so sorting everything isn't worth it
+        size_t next = beam;
+        for(size_t i = beam + 1; i < count; i++) {
+            if(scores[i] > scores[next]) next = i;
+        }
+
+        AiMove move = moves[next];
+        moves[next] = moves[beam];
+        scores[next] = scores[beam];
+        moves[beam] = move;
+
+        panel_restore(panel, snapshot);
+        apply_move(panel, move);
+        int score = resolve_panel(panel, worker->arena);
+        int value = score + search(job, worker, depth - 1) * DISCOUNT_NUM / DISCOUNT_DEN;
+        best = MAX(best, value);
+    }
+
+    // an aborted search skipped moves so its value isn't right
+    if(!atomic_load_explicit(&job->aborted, memory_order_relaxed)) {
+        transposition_table_store(job->ai->table, hash, depth, best);
+    }
+
+    arena_reset_to(worker->arena, mark);
+    return best;
+}
+
+static void search_root_moves(void *ctx, size_t workerIndex, size_t workerCount) {
+    SearchJob *job = ctx;
+    AiWorker *worker = &job->ai->workers[workerIndex];
+
+    // the moves are interleaved so every worker gets moves from every part of the panel
+    for(size_t i = workerIndex; i < job->moveCount; i += workerCount) {
+        if(is_search_aborted(job)) return;
+
+        panel_restore(&worker->panel, job->root);
+        apply_move(&worker->panel, job->moves[i]);
+
+        int score = resolve_panel(&worker->panel, worker->arena);
+        job->scores[i] = score + search(job, worker, job->depth - 1) * DISCOUNT_NUM / DISCOUNT_DEN;
+    }
+}
+
+Ai *ai_create(size_t workerCount, size_t rowCapacity, int maxDepth, double budgetMs) {
+    Ai *ai = calloc(1, sizeof(Ai));
+    assert(ai != NULL && "Not enough memory");
+
+    ai->pool = thread_pool_create(workerCount);
+    ai->maxDepth = MAX(maxDepth, 1);
+    ai->budgetNs = budgetMs * 1e6;
+    ai->table = transposition_table_create(AI_TT_ENTRIES);
+
+    ai->workers = calloc(ai->pool->workerCount, sizeof(AiWorker));
+    assert(ai->workers != NULL && "Not enough memory");
+
+    for(size_t i = 0; i < ai->pool->workerCount; i++) {
+        AiWorker *worker = &ai->workers[i];
+        panel_init(&worker->panel, rowCapacity);
+        worker->arena = arena_create(AI_ARENA_SIZE);
+    }
+
+    ai->rowCapacity = ai->workers[0].panel.rows.capacity;
+    return ai;
+}
+
+void ai_free(Ai *ai) {
+    for(size_t i = 0; i < ai->pool->workerCount; i++) {
+        AiWorker *worker = &ai->workers[i];
+        arena_free(worker->arena);
+        panel_free(&worker->panel);
+    }
+
+    free(ai->workers);
+    transposition_table_free(ai->table);
+    thread_pool_free(ai->pool);
+    free(ai);
+}
+
+bool ai_find_move(Ai *ai, Panel *panel, AiMove *move) {
+    if(panel->rows.count > ai->rowCapacity) {
+        log_error("The panel has %zu rows but the ai only fits %zu", panel->rows.count, ai->rowCapacity);
+        return false;
+    }
+
+    // the search starts from the panel as it will be once everything falls and clears
+    AiWorker *first = &ai->workers[0];
+    arena_clear(first->arena);
+    panel_restore(&first->panel, panel_snapshot_arena(panel, first->arena));
+    resolve_panel(&first->panel, first->arena);
+
+    SearchJob *job = calloc(1, sizeof(SearchJob));
+    assert(job != NULL && "Not enough memory");
+
+    // the searches of the first worker only release what they allocate, so the root stays in its arena
+    job->ai = ai;
+    job->root = panel_snapshot_arena(&first->panel, first->arena);
+
+    for(int y = 0; y < PANEL_ROWS; y++) {
+        for(int x = 0; x < PANEL_COLS - 1; x++) {
+            AiMove m = {x, y};
+            if(is_move_useful(job->root, m)) job->moves[job->moveCount++] = m;
+        }
+    }
+
+    int bestScores[AI_MOVE_COUNT];
+    bool found = false;
+
+    if(job->moveCount > 0) {
+        job->deadline = ai->budgetNs != 0 ? profiler_now() + ai->budgetNs : 0;
+
+        // every depth that finishes in time replaces the scores of the previous one
+        for(int depth = 1; depth <= ai->maxDepth; depth++) {
+            // the moves that aren't searched before the deadline are never chosen
+            for(size_t i = 0; i < job->moveCount; i++) job->scores[i] = INT_MIN;
+
+            job->depth = depth;
+            thread_pool_run(ai->pool, search_root_moves, job);
+
+            if(atomic_load(&job->aborted) && found) break;
+
+            memcpy(bestScores, job->scores, job->moveCount * sizeof(int));
+            found = true;
+            if(atomic_load(&job->aborted)) break;
+        }
+
+        // only the moves that were scored can be chosen, the first depth can run out of time before scoring any
+        size_t best = 0;
+        for(size_t i = 1; i < job->moveCount; i++) {
+            if(bestScores[i] > bestScores[best]) best = i;
+        }
+
+        if(found && bestScores[best] == INT_MIN) found = false;
+        if(found) *move = job->moves[best];
+    }
+
+    free(job);
+    return found;
+}
+
+Input ai_player_update(AiPlayer *player, Panel *panel) {
+    if(player->cooldown > 0) {
+        player->cooldown--;
+        return 0;
+    }
+
+    if(!player->hasMove) {
+        player->hasMove = ai_find_move(player->ai, panel, &player->move);
+        if(!player->hasMove) return 0;
+    }
+
+    player->cooldown = AI_INPUT_DELAY;
+
+    // the cursor moves one position per input until it reaches the move
+    if(panel->cursor.x < player->move.x) return INPUT_RIGHT;
+    if(panel->cursor.x > player->move.x) return INPUT_LEFT;
+    if(panel->cursor.y < player->move.y) return INPUT_DOWN;
+    if(panel->cursor.y > player->move.y) return INPUT_UP;
+
+    player->hasMove = false;
+    return INPUT_SWAP;
+}
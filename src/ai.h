@@ -0,0 +1,52 @@
+#ifndef AI_H
+#define AI_H
+
+#include "panel.h"
+#include "thread_pool.h"
+#include "transposition.h"
+
+#define AI_MOVE_COUNT ((PANEL_COLS - 1) * PANEL_ROWS) // every position of the cursor
+#define AI_BEAM_WIDTH 8 // moves expanded after the first ply, the rest are pruned
+#define AI_INPUT_DELAY 6 // ticks the AI player waits between inputs
+#define AI_TT_ENTRIES (1 << 18) // entries of the transposition table, 16 bytes each
+
+// a swap made with the cursor at x, y
+typedef struct {
+    int x;
+    int y;
+} AiMove;
+
+typedef struct {
+    Panel panel; // scratch panel where the moves are simulated
+    Arena *arena; // combo events and the state before the moves of every depth
+} AiWorker;
+
+// searches the best swap simulating the moves with the headless simulation, the first ply is split between the
+// workers of the pool and the search deepens one ply at a time until maxDepth or until the time budget runs out
+typedef struct {
+    ThreadPool *pool;
+    AiWorker *workers; // one per worker of the pool
+    TranspositionTable *table; // values of the states already searched, shared by the workers and kept between searches
+    int maxDepth;
+    uint64_t budgetNs; // 0 means no time limit
+    size_t rowCapacity;
+} Ai;
+
+// a workerCount of 0 uses one worker per core, a budgetMs of 0 means no time limit
+Ai *ai_create(size_t workerCount, size_t rowCapacity, int maxDepth, double budgetMs);
+void ai_free(Ai *ai);
+
+// returns false if there is no move that changes the panel or the time ran out before any move was scored
+bool ai_find_move(Ai *ai, Panel *panel, AiMove *move);
+
+// plays a panel sending the inputs to reach the moves found by the ai
+typedef struct {
+    Ai *ai;
+    AiMove move;
+    bool hasMove;
+    int cooldown; // ticks left until the next input
+} AiPlayer;
+
+Input ai_player_update(AiPlayer *player, Panel *panel); // returns the input of the current tick
+
+#endif // AI_H
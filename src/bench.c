@@ -0,0 +1,306 @@
+// Micro-benchmarks of the panel update kernels, it prints a tab separated table so the results can be tracked
+// between changes, followed by a table of panel_set_update with every number of workers. Usage: bench [kernel]
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "CCFuncs.h"
+#include "ai.h"
+#include "panel.h"
+#include "panel_set.h"
+
+#define BENCH_SEED 1234
+#define BENCH_MIN_NS 200000000 // every benchmark runs at least this time
+#define BENCH_MIN_ITERATIONS 16
+#define BENCH_SET_PANELS 1024
+#define BENCH_SET_TICKS 2048
+
+typedef struct {
+    Panel panel;
+    PanelSnapshot *initial; // the state restored before every iteration of the kernels that modify the panel
+} BenchPanel;
+
+typedef void (*BenchKernel)(BenchPanel *bp, size_t iteration);
+
+typedef struct {
+    const char *name;
+    BenchKernel run;
+    bool restore; // restores the panel before every iteration, the time of the restore isn't counted
+    size_t (*cells)(Panel *panel); // cells processed by every iteration
+} Bench;
+
+static size_t all_cells(Panel *panel) {
+    return panel->rows.count * PANEL_COLS;
+}
+
+static size_t swapped_cells(Panel *panel) {
+    return 2;
+}
+
+static void restore_panel(BenchPanel *bp) {
+    panel_restore(&bp->panel, bp->initial);
+}
+
+static void bench_restore(BenchPanel *bp, size_t iteration) {
+    restore_panel(bp);
+}
+
+// every row is checked, as the panel has no combos it doesn't change
+static void bench_combos_full(BenchPanel *bp, size_t iteration) {
+    mark_rows_dirty(&bp->panel, 0, bp->panel.rows.count - 1);
+    update_combos(&bp->panel, NULL);
+}
+
+// nothing changed since the last check
+static void bench_combos_clean(BenchPanel *bp, size_t iteration) {
+    update_combos(&bp->panel, NULL);
+}
+
+static void bench_gravity_step(BenchPanel *bp, size_t iteration) {
+    restore_panel(bp);
+    gravity_step(&bp->panel);
+}
+
+static void bench_settle(BenchPanel *bp, size_t iteration) {
+    restore_panel(bp);
+    settle_panel(&bp->panel);
+}
+
+static void bench_swap(BenchPanel *bp, size_t iteration) {
+    bp->panel.cursor.x = iteration % (PANEL_COLS - 1);
+    bp->panel.cursor.y = iteration % PANEL_ROWS;
+    swap_blocks(&bp->panel);
+}
+
+static const Bench BENCHES[] = {
+    {"update_combos", bench_combos_full, false, all_cells},
+    {"update_combos_clean", bench_combos_clean, false, all_cells},
+    {"gravity_step", bench_gravity_step, true, all_cells},
+    {"settle_panel", bench_settle, true, all_cells},
+    {"swap_blocks", bench_swap, false, swapped_cells},
+};
+
+static const size_t HEIGHTS[] = {12, 100, 10000};
+static const double DENSITIES[] = {0.25, 0.5, 1.0};
+
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+// fills the panel with settled columns that hold density of the cells of height rows, without combos
+static void fill_panel(Panel *panel, size_t height, double density) {
+    panel_seed(panel, BENCH_SEED, 0);
+
+    // every cell is kept with a probability of density and the kept ones are compacted to the bottom of their column,
+    // so no block is falling and update_combos sees every block of the board
+    size_t heights[PANEL_COLS] = {0};
+    for(size_t row = 0; row < height; row++) {
+        for(int col = 0; col < PANEL_COLS; col++) {
+            if(rng_next(&panel->rng) < density * UINT32_MAX) heights[col]++;
+        }
+    }
+
+    // the rows are generated against the rows below them once their columns are cut, removing blocks never makes a
+    // combo so the board has none
+    for(size_t row = 0; row < height; row++) {
+        Row near = row >= 1 ? *panel_row(panel, row - 1) : 0;
+        Row far = row >= 2 ? *panel_row(panel, row - 2) : 0;
+
+        Row r = generate_row(&panel->rng, near, far);
+        for(int col = 0; col < PANEL_COLS; col++) {
+            if(row >= heights[col]) row_set_type(&r, col, BLOCK_NONE);
+        }
+        append_row(panel, r);
+    }
+    trim_empty_rows(panel);
+
+    // the panel starts clean so update_combos_clean doesn't do any work
+    update_combos(panel, NULL);
+}
+
+// checks that the settled blocks of the panel are close to density of the cells of height rows
+static bool check_density(Panel *panel, size_t height, double density) {
+    size_t settled = 0;
+    for(int row = 0; row < panel->rows.count; row++) {
+        Row r = *panel_row(panel, row);
+        settled += __builtin_popcount(row_get_occupied(r) & ~row_get_falling(r));
+    }
+
+    // three standard deviations of the number of kept cells
+    double cells = height * PANEL_COLS;
+    double tolerance = 3 * sqrt(density * (1 - density) / cells) + 1 / cells;
+    double actual = settled / cells;
+    if(fabs(actual - density) > tolerance) {
+        log_error("The panel of %zu rows has %.3f of its cells settled instead of %.2f", height, actual, density);
+        return false;
+    }
+
+    return true;
+}
+
+// checks that a panel rising for many times its capacity keeps using the same rows, and that it tops out once the
+// stack fills the visible rows
+static bool check_rising(void) {
+    Panel panel = {0};
+    panel_init(&panel, PANEL_ROW_CAPACITY);
+    panel_seed(&panel, BENCH_SEED, 0);
+    generate_rows(&panel, PANEL_START_ROWS);
+
+    Row *items = panel.rows.items;
+    size_t capacity = panel.rows.capacity;
+    size_t rises = capacity * 4;
+
+    for(size_t i = 0; i < rises; i++) {
+        // the top row is cleared before every rise like a combo would, so the stack keeps its height
+        Row *top = panel_row(&panel, panel.rows.count - 1);
+        for(int col = 0; col < PANEL_COLS; col++) row_set_type(top, col, BLOCK_NONE);
+        trim_empty_rows(&panel);
+        panel_rehash(&panel);
+
+        for(int tick = 0; tick < RISE_TICKS; tick++) update_rise(&panel);
+    }
+
+    if(panel.rows.items != items || panel.rows.capacity != capacity || panel.rows.count != PANEL_START_ROWS
+       || panel.toppedOut) {
+        log_error("The panel changed its rows after %zu rises (%zu rows of %zu)", rises, panel.rows.count,
+            panel.rows.capacity);
+        panel_free(&panel);
+        return false;
+    }
+
+    for(int i = 0; i < PANEL_ROWS && !panel.toppedOut; i++) {
+        for(int tick = 0; tick < RISE_TICKS; tick++) update_rise(&panel);
+    }
+
+    bool ok = panel.toppedOut && panel.rows.count == PANEL_ROWS;
+    if(!ok) log_error("The panel didn't top out with %zu rows", panel.rows.count);
+
+    panel_free(&panel);
+    return ok;
+}
+
+// checks that an ai whose time budget is over before it scores any move doesn't return a move
+static bool check_ai_budget(void) {
+    Panel panel = {0};
+    panel_init(&panel, PANEL_ROW_CAPACITY);
+    panel_seed(&panel, BENCH_SEED, 0);
+    generate_rows(&panel, PANEL_START_ROWS);
+
+    // a budget of 0 means no limit, so the smallest one that is already over is used
+    Ai *ai = ai_create(1, PANEL_ROW_CAPACITY, 3, 1e-6);
+    AiMove move;
+    bool found = ai_find_move(ai, &panel, &move);
+    if(found) log_error("The ai returned the move %d, %d without time to score it", move.x, move.y);
+
+    ai_free(ai);
+    panel_free(&panel);
+    return !found;
+}
+
+// returns the nanoseconds per iteration of the kernel
+static double time_kernel(BenchKernel run, BenchPanel *bp, size_t *iterations) {
+    size_t n = 0;
+    uint64_t start = profiler_now();
+    uint64_t elapsed = 0;
+
+    while(elapsed < BENCH_MIN_NS || n < BENCH_MIN_ITERATIONS) {
+        // the clock is read every 16 iterations so it doesn't weight much in the fast kernels
+        for(int i = 0; i < 16; i++) run(bp, n++);
+        elapsed = profiler_now() - start;
+    }
+
+    *iterations = n;
+    return (double)elapsed / n;
+}
+
+// returns the nanoseconds per tick of panel_set_update with workerCount workers, inputs has the input of every panel
+// in every tick so all the worker counts simulate exactly the same games
+static double time_panel_set(size_t workerCount, Input *inputs) {
+    PanelSet *set = panel_set_create(BENCH_SET_PANELS, PANEL_ROWS, workerCount);
+    panel_set_seed(set, BENCH_SEED);
+    for(size_t i = 0; i < set->count; i++) {
+        generate_rows(&set->items[i], PANEL_START_ROWS);
+    }
+
+    uint64_t start = profiler_now();
+    for(size_t tick = 0; tick < BENCH_SET_TICKS; tick++) {
+        panel_set_update(set, &inputs[tick * BENCH_SET_PANELS]);
+    }
+    uint64_t elapsed = profiler_now() - start;
+
+    panel_set_free(set);
+    return (double)elapsed / BENCH_SET_TICKS;
+}
+
+static void bench_panel_set(void) {
+    // a third of the ticks have a random move or swap
+    Input *inputs = malloc(BENCH_SET_TICKS * BENCH_SET_PANELS * sizeof(Input));
+    assert(inputs != NULL && "Not enough memory");
+
+    Rng rng;
+    rng_seed(&rng, BENCH_SEED, 0);
+    for(size_t i = 0; i < BENCH_SET_TICKS * BENCH_SET_PANELS; i++) {
+        inputs[i] = rng_range(&rng, 3) == 0 ? 1 << rng_range(&rng, 5) : 0;
+    }
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if(cores < 1) cores = 1;
+
+    printf("\nkernel\tpanels\tworkers\tticks\tns_per_op\tpanels_per_sec\n");
+    for(size_t workers = 1; workers <= (size_t)cores; workers++) {
+        double ns = time_panel_set(workers, inputs);
+        double panelsPerSec = ns > 0 ? BENCH_SET_PANELS / ns * 1e9 : 0;
+        printf("panel_set_update\t%d\t%zu\t%d\t%.1f\t%.0f\n",
+               BENCH_SET_PANELS, workers, BENCH_SET_TICKS, ns, panelsPerSec);
+    }
+
+    free(inputs);
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+
+    if(!check_rising() || !check_ai_budget()) return 1;
+
+    printf("kernel\trows\tdensity\titerations\tns_per_op\tcells_per_sec\n");
+
+    for(size_t h = 0; h < ARRAY_LEN(HEIGHTS); h++) {
+        for(size_t d = 0; d < ARRAY_LEN(DENSITIES); d++) {
+            BenchPanel bp = {0};
+            panel_init(&bp.panel, HEIGHTS[h]);
+            fill_panel(&bp.panel, HEIGHTS[h], DENSITIES[d]);
+            if(!check_density(&bp.panel, HEIGHTS[h], DENSITIES[d])) return 1;
+
+            bp.initial = malloc(panel_snapshot_size(&bp.panel));
+            panel_snapshot(&bp.panel, bp.initial);
+
+            for(size_t b = 0; b < ARRAY_LEN(BENCHES); b++) {
+                const Bench *bench = &BENCHES[b];
+                if(filter != NULL && strcmp(filter, bench->name) != 0) continue;
+
+                restore_panel(&bp);
+
+                size_t iterations;
+                double ns = time_kernel(bench->run, &bp, &iterations);
+
+                // the time spent restoring the panel isn't part of the kernel
+                if(bench->restore) {
+                    size_t restoreIterations;
+                    ns -= time_kernel(bench_restore, &bp, &restoreIterations);
+                    if(ns < 0) ns = 0;
+                }
+
+                double cellsPerSec = ns > 0 ? bench->cells(&bp.initial->panel) / ns * 1e9 : 0;
+                printf("%s\t%zu\t%.2f\t%zu\t%.1f\t%.0f\n",
+                       bench->name, HEIGHTS[h], DENSITIES[d], iterations, ns, cellsPerSec);
+            }
+
+            free(bp.initial);
+            panel_free(&bp.panel);
+        }
+    }
+
+    if(filter == NULL || strcmp(filter, "panel_set_update") == 0) bench_panel_set();
+
+    return 0;
+}
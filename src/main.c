@@ -1,266 +1,183 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <time.h>
 
 #include "raylib.h"
-#define CCFUNCS_IMPLEMENTATION
 #include "CCFuncs.h"
-
-#define PANEL_COLS 6 // total columns per row in a panel
-#define PANEL_ROWS 12 // visible rows of a panel, in practice it could have infinite rows
-
-#define MIN(a, b) ((a) > (b) ? (b) : (a))
-#define MAX(a, b) ((a) > (b) ? (a) : (b))
-
-typedef enum {
-    BLOCK_NONE = 0,
-    BLOCK_YELLOW,
-    BLOCK_GREEN,
-    BLOCK_BLUE,
-    BLOCK_RED,
-    BLOCK_PURPLE,
-} BlockType;
-
-typedef struct {
-    BlockType type;
-    bool isPartOfCombo; // used by the combo system
-    bool falling;
-} Block;
-
-// this colors are in the same order as the BlockType enum
-const Color BLOCK_COLORS[] = {{0, 0, 0, 0}, YELLOW, GREEN, BLUE, RED, PURPLE};
-
-typedef struct {
-    Block items[PANEL_COLS];
-} Row;
-
-typedef struct {
-    // NOTE: the panel blocks are stored in the array from bottom to top, it means that the first row in the array
-    // is the bottom row in the panel.
-    struct {
-        // a dynamic array of rows with PANEL_COLS columns each
-        Row *items;
-        size_t count;
-        size_t capacity;
-    } rows;
-
-    Vector2 pos;
-    Vector2 size;
-    struct {
-        int x;
-        int y;
-    } cursor;
-} Panel;
-
-bool is_block_outbounds(Panel *panel, int row, int col) {
-    return row < 0 || row >= panel->rows.count || col < 0 || col >= PANEL_COLS;
+#include "ai.h"
+#include "netplay.h"
+#include "panel.h"
+#include "render.h"
+#include "replay.h"
+
+#define TICK_TIME (1.0f / TICK_RATE)
+#define MAX_TICKS_PER_FRAME 8 // when rendering stalls the simulation never catches up more than this
+#define TICK_ARENA_SIZE (16 * 1024) // region size of the arena with the data of a single tick
+#define OVERLAY_GAP 10 // space between the profiler and the arena overlays
+
+#define AI_DEPTH 3
+#define AI_BUDGET_MS 10
+
+Input read_input(void) {
+    Input input = 0;
+    if(IsKeyPressed(KEY_LEFT)) input |= INPUT_LEFT;
+    if(IsKeyPressed(KEY_RIGHT)) input |= INPUT_RIGHT;
+    if(IsKeyPressed(KEY_UP)) input |= INPUT_UP;
+    if(IsKeyPressed(KEY_DOWN)) input |= INPUT_DOWN;
+    if(IsKeyPressed(KEY_X)) input |= INPUT_SWAP;
+    return input;
 }
 
-Block *get_block(Panel *panel, int row, int col) {
-    if(is_block_outbounds(panel, row, col)) return NULL;
-    return &panel->rows.items[row].items[col];
-}
-
-bool can_block_combo(Panel *panel, int row, int col, BlockType type) {
-    Block *b = get_block(panel, row, col);
-    if(b == NULL) return false;
-
-    return b->type == type && !b->falling;
+static Rectangle get_panel_bounds(float centerX) {
+    Vector2 panelSize = {GetScreenHeight() / PANEL_ROWS * PANEL_COLS, GetScreenHeight()};
+    return (Rectangle){
+        .x = centerX - panelSize.x / 2,
+        .y = GetScreenHeight() / 2 - panelSize.y / 2,
+        .width = panelSize.x,
+        .height = panelSize.y,
+    };
 }
 
-void swap_blocks(Panel *panel) {
-    int row = PANEL_ROWS - panel->cursor.y - 1;
-    int col = panel->cursor.x;
-
-    if(row < panel->rows.count) {
-        // swap blocks
-        Block *leftBlock = get_block(panel, row, col);
-        if(leftBlock == NULL) {
-            log_error("Left block of the cursor is NULL (row: %d, col: %d)", row, col);
-            return;
-        }
-
-        Block *rightBlock = get_block(panel, row, col + 1);
-        if(rightBlock == NULL) {
-            log_error("Right block of the cursor is NULL (row: %d, col: %d)", row, col);
-            return;
+// Usage: main [--record file.rpl] [--replay file.rpl] [--ai] [--seed n] [--vs player localPort remoteHost remotePort]
+//   --vs plays against another instance started with the other player (0 or 1) and the same --seed, which is required
+int main(int argc, char **argv) {
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    AiPlayer aiPlayer = {0};
+    uint64_t seed = time(NULL);
+    bool hasSeed = false;
+    Transport *transport = NULL;
+    int vsPlayer = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if(strcmp(argv[i], "--ai") == 0) {
+            aiPlayer.ai = ai_create(0, PANEL_ROW_CAPACITY, AI_DEPTH, AI_BUDGET_MS);
+        } else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+            hasSeed = true;
+        } else if(strcmp(argv[i], "--vs") == 0 && i + 4 < argc && transport == NULL) {
+            vsPlayer = atoi(argv[i + 1]) != 0;
+            transport = udp_transport_create(atoi(argv[i + 2]), argv[i + 3], atoi(argv[i + 4]));
+            if(transport == NULL) return 1;
+            i += 4;
+        } else {
+            fprintf(stderr, "usage: %s [--record file.rpl] [--replay file.rpl] [--ai] [--seed n] "
+                "[--vs player localPort remoteHost remotePort]\n", argv[0]);
+            return 1;
         }
-
-        BlockType t = leftBlock->type;
-        leftBlock->type = rightBlock->type;
-        rightBlock->type = t;
     }
-}
 
-void update_cursor(Panel *panel) {
-    if(IsKeyPressed(KEY_RIGHT)) {
-        panel->cursor.x = MIN(panel->cursor.x + 1, PANEL_COLS - 2);
-    } else if(IsKeyPressed(KEY_LEFT)) {
-        panel->cursor.x = MAX(panel->cursor.x - 1, 0);
+    // the replays only have the inputs of a single panel
+    if(transport != NULL && (recordPath != NULL || replayPath != NULL)) {
+        fprintf(stderr, "%s: --vs can't be used with --record or --replay\n", argv[0]);
+        return 1;
     }
 
-    if(IsKeyPressed(KEY_UP)) {
-        panel->cursor.y = MAX(panel->cursor.y - 1, 0);
-    } else if(IsKeyPressed(KEY_DOWN)) {
-        panel->cursor.y = MIN(panel->cursor.y + 1, PANEL_ROWS - 1);
+    // both instances need the same panels, a seed taken from the clock would only match by chance
+    if(transport != NULL && !hasSeed) {
+        fprintf(stderr, "%s: --vs needs the --seed shared with the other player\n", argv[0]);
+        return 1;
     }
 
-    if(IsKeyPressed(KEY_X)) swap_blocks(panel);
-}
-
-void update_combos(Panel *panel) {
-    for(int row = 0; row < panel->rows.count; row++) {
-        for(int col = 0; col < PANEL_COLS; col++) {
-            Block *b = get_block(panel, row, col);
-
-            if(b->type == BLOCK_NONE || b->falling) continue;
-
-            // xCount describes matching block in the x axis
-            // yCount describes matching block in the y axis
-            int xCount = 1, yCount = 1;
-
-            while(can_block_combo(panel, row, col + xCount, b->type)) {
-                xCount++;
-            }
-
-            while(can_block_combo(panel, row + yCount, col, b->type)) {
-                yCount++;
-            }
+    // the game is played from a replay, when it ends the keyboard takes control
+    Replay playback = {0};
+    if(replayPath != NULL && !replay_load(&playback, replayPath)) return 1;
 
-            if(xCount >= 3) {
-                // skip the current (first) block
-                for(int i = 1; i < xCount; i++) {
-                    Block *block = get_block(panel, row, col + i);
-                    block->isPartOfCombo = true;
-                }
-            }
-
-            if(yCount >= 3) {
-                // skip the current (first) block
-                for(int i = 1; i < yCount; i++) {
-                    Block *block = get_block(panel, row + i, col);
-                    block->isPartOfCombo = true;
-                }
-            }
+    // every game is recorded, the replay is only saved with --record
+    Replay replay = {
+        .seed = replayPath != NULL ? playback.seed : seed,
+        .startRows = replayPath != NULL ? playback.startRows : PANEL_START_ROWS,
+    };
 
-            if(!b->isPartOfCombo) {
-                b->isPartOfCombo = xCount >= 3 || yCount >= 3;
-            }
-        }
-    }
+    InitWindow(1280, 720, "C Tetris");
+    SetTargetFPS(60);
 
-    // remove all blocks that form combos
-    for(int row = 0; row < panel->rows.count; row++) {
-        for(int col = 0; col < PANEL_COLS; col++) {
-            Block *b = get_block(panel, row, col);
-            if(!b->isPartOfCombo) continue;
-            b->type = BLOCK_NONE;
-            b->isPartOfCombo = false;
-        }
-    }
-}
+    Rectangle panelBounds = get_panel_bounds(GetScreenWidth() / 2);
+    Panel panel = {0};
+    panel_init(&panel, PANEL_ROW_CAPACITY);
 
-void update_gravity(Panel *panel) {
-    // TODO: this is temporal!
-    static float t = 0;
-    t += GetFrameTime();
+    replay_start_panel(&replay, &panel);
 
-    if(t < 0.5) {
-        return;
+    // in a versus game the panels of the session are drawn instead, the local one on the left
+    Netplay *netplay = NULL;
+    Rectangle vsBounds[NETPLAY_PLAYERS];
+    if(transport != NULL) {
+        netplay = netplay_create(transport, vsPlayer, seed);
+        vsBounds[vsPlayer] = get_panel_bounds(GetScreenWidth() / 4);
+        vsBounds[1 - vsPlayer] = get_panel_bounds(GetScreenWidth() * 3 / 4);
     }
 
-    t = 0;
-
-    for(int row = 0; row < panel->rows.count; row++) {
-        for(int col = 0; col < PANEL_COLS; col++) {
-            Block *block = get_block(panel, row, col);
-            block->falling = false;
-
-            if(row > 0) {
-                Block *botBlock = get_block(panel, row - 1, col);
-                block->falling = botBlock->falling || botBlock->type == BLOCK_NONE;
-            }
-
-            if(block->type != BLOCK_NONE) continue;
-
-            // can go outbunds but it's handled correctly
-            Block *topBlock = get_block(panel, row + 1, col);
-            if(topBlock == NULL || topBlock->type == BLOCK_NONE) continue;
+    // the simulation runs at a fixed TICK_RATE independent of the frame rate
+    float tickAccumulator = 0;
+    Input pendingInput = 0;
+    Arena *tickArena = arena_create(TICK_ARENA_SIZE);
+    bool showProfiler = false;
 
-            block->type = topBlock->type;
-            topBlock->type = BLOCK_NONE;
+    while(!WindowShouldClose()) {
+        // input is polled every frame but it's consumed by the next simulated tick
+        pendingInput |= read_input();
+        if(IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+
+        tickAccumulator = MIN(tickAccumulator + GetFrameTime(), MAX_TICKS_PER_FRAME * TICK_TIME);
+        while(netplay != NULL && tickAccumulator >= TICK_TIME) {
+            Panel *localPanel = &netplay->panels[netplay->localPlayer];
+            if(aiPlayer.ai != NULL && pendingInput == 0) pendingInput = ai_player_update(&aiPlayer, localPanel);
+
+            // the input is kept until the peer catches up
+            if(!netplay_update(netplay, pendingInput)) break;
+            pendingInput = 0;
+            tickAccumulator -= TICK_TIME;
         }
-    }
-}
 
-void update_panel(Panel *panel) {
-    update_cursor(panel);
-    update_combos(panel);
-    update_gravity(panel);
-}
+        while(netplay == NULL && tickAccumulator >= TICK_TIME) {
+            Input input = pendingInput;
+            if(aiPlayer.ai != NULL) input = ai_player_update(&aiPlayer, &panel);
+            if(replay.inputs.count < playback.inputs.count) input = playback.inputs.items[replay.inputs.count];
+            replay_record(&replay, input);
 
-void draw_panel(Panel *panel) {
-    Vector2 blockSize = {
-        .x = panel->size.x / PANEL_COLS,
-        .y = panel->size.y / PANEL_ROWS,
-    };
-
-    for(int row = 0; row < panel->rows.count; row++) {
-        for(int col = 0; col < PANEL_COLS; col++) {
-            Block *block = get_block(panel, row, col);
-            if(block->type == BLOCK_NONE) continue;
-
-            Color color = BLOCK_COLORS[block->type];
-
-            int x = panel->pos.x + col * blockSize.x;
-            int y = panel->pos.y + panel->size.y - (row + 1) * blockSize.y;
-
-            DrawRectangle(x, y, blockSize.x, blockSize.y, color);
+            arena_clear(tickArena);
+            update_panel(&panel, input, tickArena);
+            pendingInput = 0;
+            tickAccumulator -= TICK_TIME;
         }
-    }
 
-    Rectangle cursorRec = {
-        .x = panel->pos.x + panel->cursor.x * blockSize.x,
-        .y = panel->pos.y + panel->cursor.y * blockSize.y,
-        .width = blockSize.x * 2,
-        .height = blockSize.y,
-    };
-    DrawRectangleLinesEx(cursorRec, 5, WHITE);
-}
-
-int main(void) {
-    InitWindow(1280, 720, "C Tetris");
-    SetTargetFPS(60);
-
-    Vector2 panelSize = {GetScreenHeight() / PANEL_ROWS * PANEL_COLS, GetScreenHeight()};
-    Panel panel = {
-        .pos = {
-            .x = GetScreenWidth() / 2 - panelSize.x / 2,
-            .y = GetScreenHeight() / 2 - panelSize.y / 2,
-        },
-        .size = panelSize,
-    };
+        BeginDrawing();
+        ClearBackground(BLACK);
 
-    srand(time(NULL));
-    for(int j = 0; j < 10; j++) {
-        Row row = {0};
+        // while waiting for the peer the accumulator keeps the ticks that couldn't run, but the blocks are never drawn
+        // further than the next tick
+        float tickAlpha = MIN(tickAccumulator / TICK_TIME, 1);
 
-        for(int i = 0; i < PANEL_COLS; i++) {
-            row.items[i].type = rand() % 5 + 1;
+        PROFILE_BEGIN(draw_panel);
+        if(netplay != NULL) {
+            draw_panels(netplay->panels, vsBounds, NETPLAY_PLAYERS, tickAlpha);
+        } else {
+            draw_panel(&panel, panelBounds, tickAlpha);
         }
+        PROFILE_END(draw_panel);
 
-        da_append(&panel.rows, row);
-    }
-
-    while(!WindowShouldClose()) {
-        BeginDrawing();
-        ClearBackground(BLACK);
-
-        update_panel(&panel);
-        draw_panel(&panel);
+        if(showProfiler) {
+            int y = draw_profiler_overlay(10, 10);
+            draw_arena_overlay("tick arena", netplay != NULL ? netplay->arena : tickArena, 10, y + OVERLAY_GAP);
+        }
 
         EndDrawing();
+        profiler_end_frame();
     }
 
+    if(recordPath != NULL) replay_save(&replay, recordPath);
+    replay_free(&replay);
+    replay_free(&playback);
+    if(aiPlayer.ai != NULL) ai_free(aiPlayer.ai);
+    if(netplay != NULL) netplay_free(netplay);
+    if(transport != NULL) transport_free(transport);
+
+    arena_free(tickArena);
+    panel_free(&panel);
     CloseWindow();
 }
@@ -0,0 +1,156 @@
+#include "CCFuncs.h"
+#include "netplay.h"
+
+#define INPUT_MASK (NETPLAY_INPUT_WINDOW - 1)
+#define SNAPSHOT_MASK (NETPLAY_SNAPSHOTS - 1)
+
+static void simulate_tick(Netplay *netplay, uint32_t tick) {
+    // the inputs are key presses, repeating the last one would press the key again so no input is the best guess
+    int remote = 1 - netplay->localPlayer;
+    if(tick >= netplay->confirmedTick) netplay->inputs[remote][tick & INPUT_MASK] = 0;
+
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        panel_snapshot(&netplay->panels[player], netplay->snapshots[tick & SNAPSHOT_MASK][player]);
+    }
+
+    arena_clear(netplay->arena);
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        update_panel(&netplay->panels[player], netplay->inputs[player][tick & INPUT_MASK], netplay->arena);
+    }
+}
+
+static void rollback(Netplay *netplay) {
+    if(netplay->rollbackTick >= netplay->tick) return;
+
+    PROFILE_BEGIN(netplay_rollback);
+    uint64_t start = profiler_now();
+
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        panel_restore(&netplay->panels[player], netplay->snapshots[netplay->rollbackTick & SNAPSHOT_MASK][player]);
+    }
+    for(uint32_t tick = netplay->rollbackTick; tick < netplay->tick; tick++) {
+        simulate_tick(netplay, tick);
+    }
+
+    netplay->stats.rollbacks++;
+    netplay->stats.maxTicks = MAX(netplay->stats.maxTicks, netplay->tick - netplay->rollbackTick);
+    netplay->stats.maxNs = MAX(netplay->stats.maxNs, profiler_now() - start);
+    netplay->rollbackTick = netplay->tick;
+    PROFILE_END(netplay_rollback);
+}
+
+static void receive_packets(Netplay *netplay) {
+    int remote = 1 - netplay->localPlayer;
+    uint8_t packet[TRANSPORT_MAX_PACKET];
+    size_t size;
+
+    while((size = transport_receive(netplay->transport, packet, sizeof(packet))) > 0) {
+        if(size < NETPLAY_PACKET_HEADER || size != NETPLAY_PACKET_HEADER + packet[16]) continue;
+
+        uint64_t seed = le_get_u64(packet);
+        if(seed != netplay->seed) {
+            if(!netplay->wrongSeed) log_error("The peer plays with the seed %llu instead of %llu",
+                (unsigned long long)seed, (unsigned long long)netplay->seed);
+            netplay->wrongSeed = true;
+            continue;
+        }
+
+        uint32_t first = le_get_u32(packet + 8);
+        netplay->remoteAck = MAX(netplay->remoteAck, le_get_u32(packet + 12));
+
+        // the inputs are only taken in order, the ones already received are skipped
+        for(uint32_t i = 0; i < packet[16]; i++) {
+            uint32_t tick = first + i;
+            if(tick < netplay->confirmedTick) continue;
+            if(tick > netplay->confirmedTick) break;
+
+            // the peer can't be ahead by more than the max prediction, a bigger tick would overwrite the saved inputs
+            if(tick >= netplay->tick + NETPLAY_MAX_PREDICTION) break;
+
+            Input input = packet[NETPLAY_PACKET_HEADER + i];
+            Input *saved = &netplay->inputs[remote][tick & INPUT_MASK];
+            if(tick < netplay->tick && *saved != input) netplay->rollbackTick = MIN(netplay->rollbackTick, tick);
+
+            *saved = input;
+            netplay->confirmedTick++;
+        }
+    }
+}
+
+static void send_inputs(Netplay *netplay) {
+    uint32_t first = MIN(netplay->remoteAck, netplay->tick);
+    if(netplay->tick - first > NETPLAY_PACKET_INPUTS) first = netplay->tick - NETPLAY_PACKET_INPUTS;
+    uint32_t count = netplay->tick - first;
+
+    uint8_t packet[NETPLAY_PACKET_HEADER + NETPLAY_PACKET_INPUTS];
+    le_put_u64(packet, netplay->seed);
+    le_put_u32(packet + 8, first);
+    le_put_u32(packet + 12, netplay->confirmedTick);
+    packet[16] = count;
+    for(uint32_t i = 0; i < count; i++) {
+        packet[NETPLAY_PACKET_HEADER + i] = netplay->inputs[netplay->localPlayer][(first + i) & INPUT_MASK];
+    }
+
+    transport_send(netplay->transport, packet, NETPLAY_PACKET_HEADER + count);
+}
+
+Netplay *netplay_create(Transport *transport, int localPlayer, uint64_t seed) {
+    Netplay *netplay = calloc(1, sizeof(Netplay));
+    assert(netplay != NULL && "Not enough memory");
+
+    netplay->transport = transport;
+    netplay->localPlayer = localPlayer;
+    netplay->seed = seed;
+    netplay->arena = arena_create(NETPLAY_ARENA_SIZE);
+
+    // both players get the same rows
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        Panel *panel = &netplay->panels[player];
+        panel_init(panel, PANEL_ROW_CAPACITY);
+        panel_seed(panel, seed, 0);
+        generate_rows(panel, PANEL_START_ROWS);
+    }
+
+    // the snapshots are allocated once so a rollback never allocates
+    size_t snapshotSize = sizeof(PanelSnapshot) + netplay->panels[0].rows.capacity * sizeof(Row);
+    for(int i = 0; i < NETPLAY_SNAPSHOTS; i++) {
+        for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+            netplay->snapshots[i][player] = malloc(snapshotSize);
+            assert(netplay->snapshots[i][player] != NULL && "Not enough memory");
+        }
+    }
+
+    return netplay;
+}
+
+void netplay_free(Netplay *netplay) {
+    for(int i = 0; i < NETPLAY_SNAPSHOTS; i++) {
+        for(int player = 0; player < NETPLAY_PLAYERS; player++) free(netplay->snapshots[i][player]);
+    }
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) panel_free(&netplay->panels[player]);
+
+    arena_free(netplay->arena);
+    free(netplay);
+}
+
+void netplay_poll(Netplay *netplay) {
+    receive_packets(netplay);
+    rollback(netplay);
+    send_inputs(netplay);
+}
+
+bool netplay_update(Netplay *netplay, Input input) {
+    receive_packets(netplay);
+    rollback(netplay);
+
+    bool waiting = netplay->tick >= netplay->confirmedTick + NETPLAY_MAX_PREDICTION;
+    if(!waiting) {
+        netplay->inputs[netplay->localPlayer][netplay->tick & INPUT_MASK] = input;
+        simulate_tick(netplay, netplay->tick);
+        netplay->tick++;
+        netplay->rollbackTick = netplay->tick;
+    }
+
+    send_inputs(netplay);
+    return !waiting;
+}
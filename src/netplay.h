@@ -0,0 +1,56 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include "panel.h"
+#include "transport.h"
+
+#define NETPLAY_PLAYERS 2
+#define NETPLAY_MAX_PREDICTION 8 // ticks simulated past the last remote input, then the session waits for the peer
+#define NETPLAY_SNAPSHOTS 16 // saved ticks, a power of two bigger than NETPLAY_MAX_PREDICTION
+#define NETPLAY_INPUT_WINDOW 64 // saved inputs, a power of two
+#define NETPLAY_PACKET_INPUTS 32 // the packets repeat the last inputs so a lost packet doesn't need to be resent
+#define NETPLAY_ARENA_SIZE (16 * 1024)
+
+// Packet format (every number is little endian):
+//   - u64 seed of the game, the packets of a peer with another seed are ignored
+//   - u32 tick of the first input, u32 ack (the sender has the inputs of the receiver of the ticks before it)
+//   - u8 number of inputs, the inputs of the sender of consecutive ticks
+#define NETPLAY_PACKET_HEADER 17
+
+// a versus game where every peer simulates both panels. The inputs of the peer arrive late, so the session predicts
+// them and keeps simulating. When the real input differs from the prediction the panels go back to the snapshot of
+// that tick and the ticks until the current one are simulated again with the right inputs (rollback).
+typedef struct {
+    Panel panels[NETPLAY_PLAYERS];
+    int localPlayer;
+    uint64_t seed;
+    bool wrongSeed; // a packet of a peer with another seed arrived, their panels would be different
+    Transport *transport; // not owned by the session
+    Arena *arena; // combo events of the last simulated tick
+
+    uint32_t tick; // next tick to simulate
+    uint32_t confirmedTick; // the remote inputs of the ticks before this one were received
+    uint32_t remoteAck; // the peer has the local inputs of the ticks before this one
+    uint32_t rollbackTick; // first tick simulated with a wrong prediction, tick if there is none
+
+    Input inputs[NETPLAY_PLAYERS][NETPLAY_INPUT_WINDOW]; // inputs used to simulate every tick
+    PanelSnapshot *snapshots[NETPLAY_SNAPSHOTS][NETPLAY_PLAYERS]; // the panels before every tick
+
+    struct {
+        uint32_t rollbacks;
+        uint32_t maxTicks; // most ticks simulated again by a single rollback
+        uint64_t maxNs; // slowest rollback
+    } stats;
+} Netplay;
+
+// both peers have to use the same seed, localPlayer is 0 on one peer and 1 on the other one
+Netplay *netplay_create(Transport *transport, int localPlayer, uint64_t seed);
+void netplay_free(Netplay *netplay);
+
+// receives the remote inputs, rolls back if a prediction was wrong and sends the local inputs
+void netplay_poll(Netplay *netplay);
+// polls and simulates the next tick with input as the local input, returns false without simulating when the peer is
+// NETPLAY_MAX_PREDICTION ticks behind (the input should be given again in the next call)
+bool netplay_update(Netplay *netplay, Input input);
+
+#endif // NETPLAY_H
@@ -0,0 +1,108 @@
+// Headless versus game between two netplay sessions in the same process, both players press random keys and at the
+// end the panels of both peers must be the same.
+// Usage: netplay [--ticks n] [--latency ticks] [--loss rate] [--udp port]
+//   the sessions talk through an in-process fake link with the given latency and packet loss, or with --udp through
+//   two UDP sockets on localhost using the ports port and port + 1
+
+#include <stdio.h>
+
+#include "CCFuncs.h"
+#include "netplay.h"
+
+#define NETPLAY_SEED 42
+#define PRESS_CHANCE 8 // a player presses a key once every PRESS_CHANCE ticks on average
+
+static Input random_input(Rng *rng) {
+    if(rng_range(rng, PRESS_CHANCE) != 0) return 0;
+    return 1 << rng_range(rng, 5);
+}
+
+static void print_peer(Netplay *netplay) {
+    printf("player %d: ticks %u, rollbacks %u, max rollback %u ticks %.3f ms", netplay->localPlayer, netplay->tick,
+        netplay->stats.rollbacks, netplay->stats.maxTicks, netplay->stats.maxNs / 1e6);
+
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        printf(", checksum %d %016llx", player, (unsigned long long)panel_checksum(&netplay->panels[player]));
+    }
+    putchar('\n');
+}
+
+int main(int argc, char **argv) {
+    uint32_t ticks = TICK_RATE * 60;
+    uint64_t latency = 4;
+    double loss = 0.1;
+    int udpPort = 0;
+
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            latency = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            loss = strtod(argv[++i], NULL);
+        } else if(strcmp(argv[i], "--udp") == 0 && i + 1 < argc) {
+            udpPort = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--ticks n] [--latency ticks] [--loss rate] [--udp port]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    FakeLink *link = NULL;
+    Transport *transports[NETPLAY_PLAYERS];
+    if(udpPort != 0) {
+        transports[0] = udp_transport_create(udpPort, "127.0.0.1", udpPort + 1);
+        transports[1] = udp_transport_create(udpPort + 1, "127.0.0.1", udpPort);
+        if(transports[0] == NULL || transports[1] == NULL) return 1;
+    } else {
+        link = fake_link_create(latency, loss, NETPLAY_SEED);
+        transports[0] = fake_link_endpoint(link, 0);
+        transports[1] = fake_link_endpoint(link, 1);
+    }
+
+    Netplay *peers[NETPLAY_PLAYERS];
+    Rng rngs[NETPLAY_PLAYERS];
+    Input pending[NETPLAY_PLAYERS] = {0};
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        peers[player] = netplay_create(transports[player], player, NETPLAY_SEED);
+        rng_seed(&rngs[player], NETPLAY_SEED, player + 1);
+    }
+
+    // a peer that waits for the other one keeps its input until it can simulate again
+    uint64_t start = profiler_now();
+    while(peers[0]->tick < ticks || peers[1]->tick < ticks) {
+        for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+            if(peers[player]->tick >= ticks) {
+                netplay_poll(peers[player]);
+                continue;
+            }
+
+            if(pending[player] == 0) pending[player] = random_input(&rngs[player]);
+            if(netplay_update(peers[player], pending[player])) pending[player] = 0;
+        }
+        if(link != NULL) fake_link_step(link);
+    }
+
+    // the last inputs have to arrive before the panels can be compared
+    while(peers[0]->confirmedTick < ticks || peers[1]->confirmedTick < ticks) {
+        for(int player = 0; player < NETPLAY_PLAYERS; player++) netplay_poll(peers[player]);
+        if(link != NULL) fake_link_step(link);
+    }
+    double elapsed = (profiler_now() - start) / 1e9;
+
+    bool synced = true;
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        print_peer(peers[player]);
+        synced = synced && panel_checksum(&peers[0]->panels[player]) == panel_checksum(&peers[1]->panels[player]);
+    }
+    printf("time: %.3f ms\n", elapsed * 1000);
+    if(!synced) printf("the peers desynced\n");
+
+    for(int player = 0; player < NETPLAY_PLAYERS; player++) {
+        netplay_free(peers[player]);
+        if(link == NULL) transport_free(transports[player]);
+    }
+    if(link != NULL) fake_link_free(link);
+
+    return synced ? 0 : 1;
+}
@@ -0,0 +1,736 @@
+#include <string.h>
+
+#include "CCFuncs.h"
+#include "panel.h"
+
+#define COMBO_REACH 2 // a modified block can only make combos with the blocks that are at most 2 rows away
+
+void mark_row_dirty(Panel *panel, int row) {
+    // most of the rows are marked next to each other, like the rows of a falling column
+    for(int i = 0; i < panel->dirty.count; i++) {
+        RowSpan *span = &panel->dirty.items[i];
+        if(row >= span->from && row <= span->to) return;
+    }
+
+    mark_rows_dirty(panel, row, row);
+}
+
+void mark_rows_dirty(Panel *panel, int from, int to) {
+    RowSpan *spans = panel->dirty.items;
+    int count = panel->dirty.count;
+
+    int i = count++;
+    while(i > 0 && spans[i - 1].from > from) {
+        spans[i] = spans[i - 1];
+        i--;
+    }
+    spans[i] = (RowSpan) { .from = from, .to = to };
+
+    // the spans whose searched rows would touch are merged, so a combo is never split between two spans
+    int n = 0;
+    for(i = 0; i < count; i++) {
+        if(n > 0 && spans[i].from - spans[n - 1].to <= COMBO_REACH * 2 + 1) {
+            spans[n - 1].to = MAX(spans[n - 1].to, spans[i].to);
+        } else {
+            spans[n++] = spans[i];
+        }
+    }
+
+    // too many spans, the two closest become one
+    if(n > PANEL_DIRTY_SPANS) {
+        int closest = 0;
+        for(i = 1; i < n - 1; i++) {
+            if(spans[i + 1].from - spans[i].to < spans[closest + 1].from - spans[closest].to) closest = i;
+        }
+
+        spans[closest].to = spans[closest + 1].to;
+        memmove(&spans[closest + 1], &spans[closest + 2], (n - closest - 2) * sizeof(RowSpan));
+        n--;
+    }
+
+    panel->dirty.count = n;
+}
+
+// keeps the dirty spans inside the rows of the panel
+static void clamp_dirty_spans(Panel *panel) {
+    int n = 0;
+    for(int i = 0; i < panel->dirty.count; i++) {
+        RowSpan span = panel->dirty.items[i];
+        span.to = MIN(span.to, (int)panel->rows.count - 1);
+        if(span.from <= span.to) panel->dirty.items[n++] = span;
+    }
+    panel->dirty.count = n;
+}
+
+uint64_t zobrist_key(int row, int col, BlockType type) {
+    if(type == BLOCK_NONE) return 0;
+
+    // the rows are unbounded so the keys are generated with splitmix64 instead of being kept in a table
+    uint64_t key = ((uint64_t)row * PANEL_COLS + col) * BLOCK_TYPE_COUNT + type;
+    key += 0x9e3779b97f4a7c15ULL;
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+    return key ^ (key >> 31);
+}
+
+// xor of the keys of the blocks of r in the columns of mask, as if r was the logical row
+static uint64_t hash_blocks(int row, Row r, RowMask mask) {
+    uint64_t hash = 0;
+    for(int col = 0; col < PANEL_COLS; col++) {
+        if(mask & (1 << col)) hash ^= zobrist_key(row, col, row_get_type(r, col));
+    }
+    return hash;
+}
+
+void panel_rehash(Panel *panel) {
+    panel->hash = 0;
+    for(int row = 0; row < panel->rows.count; row++) {
+        panel->hash ^= hash_blocks(row, *panel_row(panel, row), ROW_MASK);
+    }
+}
+
+bool append_row(Panel *panel, Row row) {
+    if(panel->rows.count >= panel->rows.capacity) return false;
+
+    *panel_row(panel, panel->rows.count++) = row;
+    panel->hash ^= hash_blocks(panel->rows.count - 1, row, ROW_MASK);
+    mark_row_dirty(panel, panel->rows.count - 1);
+    return true;
+}
+
+bool push_row_bottom(Panel *panel, Row row) {
+    if(panel->rows.count >= panel->rows.capacity) return false;
+
+    panel->rows.head = (panel->rows.head - 1) & (panel->rows.capacity - 1);
+    panel->rows.count++;
+    *panel_row(panel, 0) = row;
+
+    // the keys depend on the logical row so every block gets a new one
+    panel_rehash(panel);
+
+    // every row moved up, so the dirty spans, the stacks and the cursor move with them
+    for(int i = 0; i < panel->dirty.count; i++) {
+        panel->dirty.items[i].from++;
+        panel->dirty.items[i].to++;
+    }
+    mark_row_dirty(panel, 0);
+
+    RowMask occupied = row_get_occupied(row);
+    for(int col = 0; col < PANEL_COLS; col++) {
+        panel->heights[col] = occupied & (1 << col) ? panel->heights[col] + 1 : 0;
+    }
+    panel->cursor.y = MAX(panel->cursor.y - 1, 0);
+    return true;
+}
+
+void trim_empty_rows(Panel *panel) {
+    while(panel->rows.count > 0 && (*panel_row(panel, panel->rows.count - 1) & ROW_TYPES_MASK) == 0) {
+        panel->rows.count--;
+    }
+
+    clamp_dirty_spans(panel);
+}
+
+void panel_init(Panel *panel, size_t rowCapacity) {
+    size_t capacity = 1;
+    while(capacity < rowCapacity) capacity *= 2;
+
+    Row *rows = calloc(capacity, sizeof(Row));
+    assert(rows != NULL && "Not enough memory");
+    panel_init_storage(panel, rows, capacity);
+}
+
+void panel_init_storage(Panel *panel, Row *rows, size_t capacity) {
+    assert((capacity & (capacity - 1)) == 0 && "The capacity must be a power of two");
+
+    panel->rows.items = rows;
+    panel->rows.head = 0;
+    panel->rows.count = 0;
+    panel->rows.capacity = capacity;
+    panel->hash = 0;
+}
+
+void panel_free(Panel *panel) {
+    free(panel->rows.items);
+}
+
+void panel_seed(Panel *panel, uint64_t seed, uint64_t stream) {
+    rng_seed(&panel->rng, seed, stream);
+}
+
+// returns the lowest type bit of every column of the row that has the given type
+static Row get_type_lsbs(Row row, BlockType type) {
+    Row diff = (row & ROW_TYPES_MASK) ^ (type * ROW_TYPE_LSBS);
+    Row differentCols = (diff | (diff >> 1) | (diff >> 2)) & ROW_TYPE_LSBS;
+    return ~differentCols & ROW_TYPE_LSBS;
+}
+
+bool row_has_match(Row row, Row near, Row far) {
+    // every column of the three rows is compared at once, the runs are searched using the lowest type bit of
+    // every column so a shift of ROW_TYPE_BITS moves to the next column
+    for(BlockType type = 1; type < BLOCK_TYPE_COUNT; type++) {
+        Row cols = get_type_lsbs(row, type);
+        if(cols == 0) continue;
+
+        Row horizontal = cols & (cols >> ROW_TYPE_BITS) & (cols >> (ROW_TYPE_BITS * 2));
+        Row vertical = cols & get_type_lsbs(near, type) & get_type_lsbs(far, type);
+        if(horizontal != 0 || vertical != 0) return true;
+    }
+    return false;
+}
+
+Row generate_row(Rng *rng, Row near, Row far) {
+    Row row = 0;
+
+    for(int col = 0; col < PANEL_COLS; col++) {
+        // one bit per BlockType that can't be used in this column, BLOCK_NONE is never used
+        uint32_t forbidden = 1 << BLOCK_NONE;
+
+        if(col >= 2 && row_get_type(row, col - 1) == row_get_type(row, col - 2)) {
+            forbidden |= 1 << row_get_type(row, col - 1);
+        }
+
+        if(row_get_type(near, col) == row_get_type(far, col)) {
+            forbidden |= 1 << row_get_type(near, col);
+        }
+
+        // instead of retrying until a valid type comes up, pick directly the nth allowed type
+        uint32_t allowed = ((1 << BLOCK_TYPE_COUNT) - 1) & ~forbidden;
+        uint32_t n = rng_range(rng, __builtin_popcount(allowed));
+        while(n-- > 0) allowed &= allowed - 1;
+
+        row_set_type(&row, col, __builtin_ctz(allowed));
+    }
+
+    assert(!row_has_match(row, near, far) && "The generated row forms a combo");
+    return row;
+}
+
+size_t generate_rows(Panel *panel, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        int top = panel->rows.count;
+        Row near = top >= 1 ? *panel_row(panel, top - 1) : 0;
+        Row far = top >= 2 ? *panel_row(panel, top - 2) : 0;
+
+        if(!append_row(panel, generate_row(&panel->rng, near, far))) return i;
+    }
+
+    return count;
+}
+
+bool is_block_outbounds(Panel *panel, int row, int col) {
+    return row < 0 || row >= panel->rows.count || col < 0 || col >= PANEL_COLS;
+}
+
+Row *get_row(Panel *panel, int row) {
+    if(row < 0 || row >= panel->rows.count) return NULL;
+    return panel_row(panel, row);
+}
+
+BlockType get_block(Panel *panel, int row, int col) {
+    if(is_block_outbounds(panel, row, col)) return BLOCK_NONE;
+    return row_get_type(*panel_row(panel, row), col);
+}
+
+// fills masks with a bitboard per block type of the blocks in the row that can be part of a combo
+static void get_row_masks(Panel *panel, int row, RowMask masks[BLOCK_TYPE_COUNT]) {
+    memset(masks, 0, BLOCK_TYPE_COUNT * sizeof(RowMask));
+
+    Row r = *panel_row(panel, row);
+    RowMask falling = row_get_falling(r);
+
+    for(int col = 0; col < PANEL_COLS; col++) {
+        if(falling & (1 << col)) continue;
+        masks[row_get_type(r, col)] |= 1 << col;
+    }
+}
+
+// returns the blocks of the mask that are part of a horizontal run of 3 or more
+static RowMask get_horizontal_runs(RowMask mask) {
+    // every bit set here is the start of a run of 3
+    RowMask starts = mask & (mask >> 1) & (mask >> 2);
+    return starts | (starts << 1) | (starts << 2);
+}
+
+// replaces the landed mask of the row with its combo, returns true if a block that just landed is part of the combo
+static bool mark_combo_blocks(Panel *panel, int row, RowMask combo) {
+    Row *r = panel_row(panel, row);
+    bool chained = (row_get_landed(*r) & combo) != 0;
+    row_set_combo(r, combo);
+    return chained;
+}
+
+void swap_blocks(Panel *panel) {
+    int row = PANEL_ROWS - panel->cursor.y - 1;
+    int col = panel->cursor.x;
+
+    if(row < panel->rows.count) {
+        if(is_block_outbounds(panel, row, col) || is_block_outbounds(panel, row, col + 1)) {
+            log_error("The cursor is out of bounds (row: %d, col: %d)", row, col);
+            return;
+        }
+
+        // swap blocks
+        Row *r = get_row(panel, row);
+        BlockType t = row_get_type(*r, col);
+        BlockType u = row_get_type(*r, col + 1);
+        RowMask landed = row_get_landed(*r);
+        row_set_type(r, col, u);
+        row_set_type(r, col + 1, t);
+
+        // a block that just landed keeps its chance to make a chain
+        RowMask pair = 3 << col;
+        if((landed & pair) != 0 && (landed & pair) != pair) row_set_landed(r, landed ^ pair);
+
+        panel->hash ^= zobrist_key(row, col, t) ^ zobrist_key(row, col, u);
+        panel->hash ^= zobrist_key(row, col + 1, t) ^ zobrist_key(row, col + 1, u);
+
+        mark_row_dirty(panel, row);
+    }
+}
+
+void update_cursor(Panel *panel, Input input) {
+    if(input & INPUT_RIGHT) {
+        panel->cursor.x = MIN(panel->cursor.x + 1, PANEL_COLS - 2);
+    } else if(input & INPUT_LEFT) {
+        panel->cursor.x = MAX(panel->cursor.x - 1, 0);
+    }
+
+    if(input & INPUT_UP) {
+        panel->cursor.y = MAX(panel->cursor.y - 1, 0);
+    } else if(input & INPUT_DOWN) {
+        panel->cursor.y = MIN(panel->cursor.y + 1, PANEL_ROWS - 1);
+    }
+
+    if(input & INPUT_SWAP) swap_blocks(panel);
+}
+
+// UNION-FIND //
+static int find_root(int *parents, int i) {
+    while(parents[i] != i) {
+        parents[i] = parents[parents[i]]; // path halving
+        i = parents[i];
+    }
+    return i;
+}
+
+static void union_cells(int *parents, int a, int b) {
+    a = find_root(parents, a);
+    b = find_root(parents, b);
+
+    // the smallest index is always the root, that way the groups keep the order of their first cell
+    if(a < b) parents[b] = a;
+    else if(b < a) parents[a] = b;
+}
+
+// reports every combo marked in the rows of the spans, where total is the number of marked blocks.
+// Blocks of the same type that touch each other are part of the same combo, so the L, T and cross shaped clears
+// are a single event, the groups are found with union-find over the marked blocks.
+static void push_combo_events(Panel *panel, Arena *arena, RowSpan *spans, int spanCount, size_t total) {
+    // every combo has at least 3 blocks, so the events are allocated before the scratch data that is released at the
+    // end, only the events and their cells stay in the arena
+    ComboEvent *events = arena_alloc(arena, total / 3 * sizeof(ComboEvent));
+    ComboCell *eventCells = arena_alloc(arena, total * sizeof(ComboCell));
+    ArenaMark scratch = arena_mark(arena);
+
+    ComboCell *cells = arena_alloc(arena, total * sizeof(ComboCell));
+    BlockType *types = arena_alloc(arena, total * sizeof(BlockType));
+    int *parents = arena_alloc(arena, total * sizeof(int));
+
+    // index of the marked block of every column in the current and previous row, -1 if it isn't marked
+    int prevRow[PANEL_COLS];
+    int curRow[PANEL_COLS];
+
+    int n = 0;
+    for(int i = 0; i < spanCount; i++) {
+        // the spans never touch each other, so no combo continues from the previous one
+        memset(prevRow, -1, sizeof(prevRow));
+
+        for(int row = spans[i].from; row <= spans[i].to; row++) {
+            Row r = *panel_row(panel, row);
+            RowMask combo = row_get_combo(r);
+            memset(curRow, -1, sizeof(curRow));
+
+            for(int col = 0; col < PANEL_COLS; col++) {
+                if(!(combo & (1 << col))) continue;
+
+                cells[n] = (ComboCell) { .row = row, .col = col };
+                types[n] = row_get_type(r, col);
+                parents[n] = n;
+
+                if(col > 0 && curRow[col - 1] >= 0 && types[curRow[col - 1]] == types[n]) {
+                    union_cells(parents, curRow[col - 1], n);
+                }
+
+                if(prevRow[col] >= 0 && types[prevRow[col]] == types[n]) {
+                    union_cells(parents, prevRow[col], n);
+                }
+
+                curRow[col] = n++;
+            }
+
+            memcpy(prevRow, curRow, sizeof(prevRow));
+        }
+    }
+
+    // every root is a new event, the rest of the blocks take the event of their root which always comes before them
+    int *eventIndex = arena_alloc(arena, total * sizeof(int));
+    size_t count = 0;
+
+    for(int i = 0; i < n; i++) {
+        int root = find_root(parents, i);
+        eventIndex[i] = root == i ? count++ : eventIndex[root];
+    }
+
+    memset(events, 0, count * sizeof(ComboEvent));
+
+    for(int i = 0; i < n; i++) {
+        events[eventIndex[i]].size++;
+    }
+
+    // the cells of every event are a slice of a single array
+    size_t offset = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        events[i].cells = eventCells + offset;
+        events[i].chain = panel->chain;
+        offset += events[i].size;
+        events[i].size = 0;
+    }
+
+    for(int i = 0; i < n; i++) {
+        ComboEvent *event = &events[eventIndex[i]];
+        event->type = types[i];
+        event->cells[event->size++] = cells[i];
+    }
+    arena_reset_to(arena, scratch);
+
+    panel->events.items = events;
+    panel->events.count = count;
+}
+
+// marks the blocks that form combos in the rows from start to end, every row is marked once so its landed mask is
+// replaced, returns true if a block that just landed is part of a combo
+static bool mark_combos(Panel *panel, int start, int end) {
+    // the masks and combos of the last three rows are kept in a sliding window indexed by row % 3,
+    // that's all we need to find vertical runs
+    RowMask masks[3][BLOCK_TYPE_COUNT];
+    RowMask combos[3] = {0};
+    bool chained = false;
+
+    for(int row = start; row < end; row++) {
+        RowMask *cur = masks[row % 3];
+        RowMask *prev = masks[(row + 2) % 3];
+        RowMask *prev2 = masks[(row + 1) % 3];
+
+        get_row_masks(panel, row, cur);
+        combos[row % 3] = 0;
+
+        // BLOCK_NONE is skipped
+        for(int type = 1; type < BLOCK_TYPE_COUNT; type++) {
+            if(cur[type] == 0) continue;
+
+            combos[row % 3] |= get_horizontal_runs(cur[type]);
+
+            if(row >= start + 2) {
+                RowMask vertical = cur[type] & prev[type] & prev2[type];
+                combos[row % 3] |= vertical;
+                combos[(row + 2) % 3] |= vertical;
+                combos[(row + 1) % 3] |= vertical;
+            }
+        }
+
+        // the row leaving the window can't be part of more combos
+        if(row >= start + 2) chained |= mark_combo_blocks(panel, row - 2, combos[(row + 1) % 3]);
+    }
+
+    // mark the rows that are still in the window
+    for(int row = MAX(end - 2, start); row < end; row++) {
+        chained |= mark_combo_blocks(panel, row, combos[row % 3]);
+    }
+
+    return chained;
+}
+
+void update_combos(Panel *panel, Arena *arena) {
+    panel->events.items = NULL;
+    panel->events.count = 0;
+
+    if(panel->dirty.count == 0) return;
+
+    // the rows searched around every dirty span, they don't touch each other
+    RowSpan spans[PANEL_DIRTY_SPANS];
+    int spanCount = panel->dirty.count;
+    for(int i = 0; i < spanCount; i++) {
+        spans[i].from = MAX(panel->dirty.items[i].from - COMBO_REACH, 0);
+        spans[i].to = MIN(panel->dirty.items[i].to + COMBO_REACH, (int)panel->rows.count - 1);
+    }
+    panel->dirty.count = 0;
+
+    size_t total = 0;
+    bool chained = false;
+    for(int i = 0; i < spanCount; i++) {
+        // the landed blocks only make a chain in the first check after landing, marking the combos forgets them
+        chained |= mark_combos(panel, spans[i].from, spans[i].to + 1);
+
+        for(int row = spans[i].from; row <= spans[i].to; row++) {
+            total += __builtin_popcount(row_get_combo(*panel_row(panel, row)));
+        }
+    }
+
+    if(total == 0) return;
+
+    // a clear without blocks that just landed starts a new chain, the gravity resets it once nothing falls
+    panel->chain = chained ? panel->chain + 1 : 1;
+    if(arena != NULL) push_combo_events(panel, arena, spans, spanCount, total);
+
+    // remove all blocks that form combos
+    for(int i = 0; i < spanCount; i++) {
+        for(int row = spans[i].from; row <= spans[i].to; row++) {
+            Row *r = panel_row(panel, row);
+            RowMask combo = row_get_combo(*r);
+            if(combo == 0) continue;
+
+            panel->hash ^= hash_blocks(row, *r, combo);
+            for(int col = 0; col < PANEL_COLS; col++) {
+                if(combo & (1 << col)) row_set_type(r, col, BLOCK_NONE);
+            }
+            row_set_combo(r, 0);
+        }
+    }
+}
+
+// returns a mask with the type bits of every column in the mask
+static Row get_type_bits(RowMask mask) {
+    Row bits = 0;
+    for(int col = 0; col < PANEL_COLS; col++) {
+        if(mask & (1 << col)) bits |= (Row)((1u << ROW_TYPE_BITS) - 1) << (col * ROW_TYPE_BITS);
+    }
+    return bits;
+}
+
+// updates the falling mask of a row that will not change anymore in this gravity pass,
+// supported is the mask of the columns that have no holes from the bottom up to the row below
+static RowMask settle_row_falling(Panel *panel, int row, RowMask supported) {
+    Row *r = panel_row(panel, row);
+    RowMask occupied = row_get_occupied(*r);
+    supported &= occupied;
+
+    // a block that stops falling can make combos now
+    RowMask falling = occupied & ~supported;
+    RowMask wasFalling = row_get_falling(*r);
+    if(wasFalling != falling) {
+        row_set_landed(r, row_get_landed(*r) | (wasFalling & ~falling));
+        row_set_falling(r, falling);
+        mark_row_dirty(panel, row);
+    }
+
+    for(int col = 0; col < PANEL_COLS; col++) {
+        if(supported & (1 << col)) panel->heights[col] = row + 1;
+    }
+
+    return supported;
+}
+
+// every column is handled at the same time: a block falls if there is a hole below it in its column, and as every
+// falling block in a column moves together the row below is always free after handling it, so a single pass from
+// the bottom is enough
+void gravity_step(Panel *panel) {
+    memset(panel->heights, 0, sizeof(panel->heights));
+
+    // supported is computed with the rows before moving anything and settledSupported with the rows after
+    RowMask supported = ROW_MASK;
+    RowMask settledSupported = ROW_MASK;
+    bool anyFalling = false;
+
+    for(int row = 0; row < panel->rows.count; row++) {
+        Row *r = panel_row(panel, row);
+        RowMask occupied = row_get_occupied(*r);
+        supported &= occupied;
+
+        RowMask falling = occupied & ~supported;
+        if(falling != 0) {
+            anyFalling = true;
+
+            Row typeBits = get_type_bits(falling);
+            Row *botRow = panel_row(panel, row - 1);
+            panel->hash ^= hash_blocks(row, *r, falling) ^ hash_blocks(row - 1, *r, falling);
+            *botRow |= *r & typeBits;
+            *r &= ~typeBits;
+
+            // the moved blocks are falling until the row below is settled, if they stop there they landed
+            row_set_falling(botRow, row_get_falling(*botRow) | falling);
+
+            mark_row_dirty(panel, row - 1);
+            mark_row_dirty(panel, row);
+        }
+
+        // the row below can't receive more blocks
+        if(row > 0) settledSupported = settle_row_falling(panel, row - 1, settledSupported);
+    }
+
+    if(panel->rows.count > 0) settle_row_falling(panel, panel->rows.count - 1, settledSupported);
+
+    // the chain ends when no block falls after a clear
+    if(!anyFalling) panel->chain = 0;
+
+    // the rows that became empty at the top are recycled
+    trim_empty_rows(panel);
+}
+
+// compacts every column using the heights as the target row of the next block of the column
+void settle_panel(Panel *panel) {
+    memset(panel->heights, 0, sizeof(panel->heights));
+    bool anyFalling = false;
+
+    for(int row = 0; row < panel->rows.count; row++) {
+        Row *r = panel_row(panel, row);
+
+        if(row_get_falling(*r) != 0) {
+            row_set_falling(r, 0);
+            mark_row_dirty(panel, row);
+        }
+
+        for(int col = 0; col < PANEL_COLS; col++) {
+            BlockType type = row_get_type(*r, col);
+            if(type == BLOCK_NONE) continue;
+
+            int target = panel->heights[col]++;
+            if(target == row) continue;
+
+            Row *targetRow = panel_row(panel, target);
+            row_set_type(targetRow, col, type);
+            row_set_landed(targetRow, row_get_landed(*targetRow) | 1 << col);
+            row_set_type(r, col, BLOCK_NONE);
+            row_set_landed(r, row_get_landed(*r) & ~(1 << col));
+            panel->hash ^= zobrist_key(row, col, type) ^ zobrist_key(target, col, type);
+            mark_row_dirty(panel, target);
+            anyFalling = true;
+        }
+    }
+
+    // the chain ends when no block falls after a clear
+    if(!anyFalling) panel->chain = 0;
+
+    trim_empty_rows(panel);
+}
+
+void update_gravity(Panel *panel) {
+    if(++panel->gravityTimer < GRAVITY_TICKS) {
+        return;
+    }
+
+    panel->gravityTimer = 0;
+    gravity_step(panel);
+}
+
+void update_rise(Panel *panel) {
+    if(++panel->riseTimer < RISE_TICKS) {
+        return;
+    }
+
+    panel->riseTimer = 0;
+
+    // the rows that leave the visible ones at the top are recycled by trim_empty_rows, so a stack that doesn't fit
+    // anymore is the end of the game instead of a bigger panel
+    int top = panel->rows.count;
+    Row near = top >= 1 ? *panel_row(panel, 0) : 0;
+    Row far = top >= 2 ? *panel_row(panel, 1) : 0;
+    if(top >= PANEL_ROWS || !push_row_bottom(panel, generate_row(&panel->rng, near, far))) {
+        panel->toppedOut = true;
+    }
+}
+
+void update_panel(Panel *panel, Input input, Arena *arena) {
+    if(panel->toppedOut) {
+        panel->events.items = NULL;
+        panel->events.count = 0;
+        return;
+    }
+
+    PROFILE_BEGIN(update_cursor);
+    update_cursor(panel, input);
+    PROFILE_END(update_cursor);
+
+    PROFILE_BEGIN(update_combos);
+    update_combos(panel, arena);
+    PROFILE_END(update_combos);
+
+    PROFILE_BEGIN(update_gravity);
+    update_gravity(panel);
+    PROFILE_END(update_gravity);
+
+    update_rise(panel);
+}
+
+size_t panel_snapshot_size(Panel *panel) {
+    return sizeof(PanelSnapshot) + panel->rows.count * sizeof(Row);
+}
+
+PanelSnapshot *panel_snapshot(Panel *panel, void *buffer) {
+    PanelSnapshot *snapshot = buffer;
+    snapshot->panel = *panel;
+
+    // the rows are copied from the ring buffer in at most two pieces
+    size_t count = panel->rows.count;
+    size_t first = MIN(count, panel->rows.capacity - panel->rows.head);
+    memcpy(snapshot->rows, &panel->rows.items[panel->rows.head], first * sizeof(Row));
+    memcpy(snapshot->rows + first, panel->rows.items, (count - first) * sizeof(Row));
+
+    return snapshot;
+}
+
+PanelSnapshot *panel_snapshot_arena(Panel *panel, Arena *arena) {
+    return panel_snapshot(panel, arena_alloc(arena, panel_snapshot_size(panel)));
+}
+
+bool panel_restore(Panel *panel, PanelSnapshot *snapshot) {
+    size_t count = snapshot->panel.rows.count;
+    if(count > panel->rows.capacity) {
+        log_error("The snapshot has %zu rows but the panel only fits %zu", count, panel->rows.capacity);
+        return false;
+    }
+
+    // the panel keeps its own rows
+    Row *items = panel->rows.items;
+    size_t capacity = panel->rows.capacity;
+
+    *panel = snapshot->panel;
+    panel->rows.items = items;
+    panel->rows.capacity = capacity;
+    panel->rows.head = 0;
+    memcpy(items, snapshot->rows, count * sizeof(Row));
+
+    // the events belong to the tick that created them
+    panel->events.items = NULL;
+    panel->events.count = 0;
+    return true;
+}
+
+// FNV-1a
+static uint64_t checksum_add(uint64_t hash, uint64_t value) {
+    for(int i = 0; i < 8; i++) {
+        hash ^= (value >> (i * 8)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t panel_checksum(Panel *panel) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    hash = checksum_add(hash, panel->rows.count);
+    for(int row = 0; row < panel->rows.count; row++) {
+        hash = checksum_add(hash, *panel_row(panel, row));
+    }
+
+    hash = checksum_add(hash, panel->cursor.x);
+    hash = checksum_add(hash, panel->cursor.y);
+    hash = checksum_add(hash, panel->rng.state);
+    hash = checksum_add(hash, panel->rng.inc);
+    hash = checksum_add(hash, panel->gravityTimer);
+    hash = checksum_add(hash, panel->riseTimer);
+    hash = checksum_add(hash, panel->toppedOut);
+    hash = checksum_add(hash, panel->chain);
+    return hash;
+}
@@ -0,0 +1,237 @@
+#ifndef PANEL_H
+#define PANEL_H
+
+// Panel simulation, it doesn't depend on raylib so it can run headless
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CCFuncs.h"
+#include "rng.h"
+
+#define PANEL_COLS 6 // total columns per row in a panel
+#define PANEL_ROWS 12 // visible rows of a panel, the rows above them are kept up to the capacity of the ring buffer
+
+#define PANEL_ROW_CAPACITY 64 // default capacity of the rows ring buffer
+#define PANEL_START_ROWS 10 // rows a new game starts with
+
+#define TICK_RATE 60 // simulation ticks per second
+#define GRAVITY_TICKS 30 // ticks between every gravity step
+#define RISE_TICKS (TICK_RATE * 6) // ticks between every new row pushed at the bottom
+#define PANEL_DIRTY_SPANS 4 // the closest dirty spans are merged when there are more
+
+#define MIN(a, b) ((a) > (b) ? (b) : (a))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+typedef enum {
+    BLOCK_NONE = 0,
+    BLOCK_YELLOW,
+    BLOCK_GREEN,
+    BLOCK_BLUE,
+    BLOCK_RED,
+    BLOCK_PURPLE,
+} BlockType;
+
+#define BLOCK_TYPE_COUNT 6 // including BLOCK_NONE
+
+// the input of a single tick, a bitmask of InputFlag
+typedef uint8_t Input;
+
+typedef enum {
+    INPUT_LEFT = 1 << 0,
+    INPUT_RIGHT = 1 << 1,
+    INPUT_UP = 1 << 2,
+    INPUT_DOWN = 1 << 3,
+    INPUT_SWAP = 1 << 4,
+} InputFlag;
+
+// a bitboard of a row, it has one bit per column where the bit 0 is the leftmost column
+typedef uint8_t RowMask;
+
+#define ROW_MASK ((1 << PANEL_COLS) - 1) // a RowMask with every column set
+
+// a row packed in a single word, starting from the lowest bit it has:
+//   - the BlockType of every column using ROW_TYPE_BITS each, the leftmost column uses the lowest bits
+//   - a RowMask of the falling blocks
+//   - a RowMask of the blocks that are part of a combo (used by the combo system), between two combo checks the same
+//     bits hold the landed mask: the blocks that stopped falling since the last check, a combo with one of them is a chain
+typedef uint32_t Row;
+
+#define ROW_TYPE_BITS 3
+#define ROW_FALLING_SHIFT (PANEL_COLS * ROW_TYPE_BITS)
+#define ROW_COMBO_SHIFT (ROW_FALLING_SHIFT + PANEL_COLS)
+#define ROW_LANDED_SHIFT ROW_COMBO_SHIFT // the landed mask reuses the combo bits
+#define ROW_TYPES_MASK ((1u << ROW_FALLING_SHIFT) - 1) // the type bits of every column
+#define ROW_TYPE_LSBS (ROW_TYPES_MASK / ((1u << ROW_TYPE_BITS) - 1)) // the lowest type bit of every column
+
+_Static_assert(ROW_COMBO_SHIFT + PANEL_COLS <= sizeof(Row) * 8, "A row doesn't fit in a single word");
+_Static_assert(BLOCK_TYPE_COUNT <= (1 << ROW_TYPE_BITS), "BlockType doesn't fit in ROW_TYPE_BITS");
+
+static inline BlockType row_get_type(Row row, int col) {
+    return (row >> (col * ROW_TYPE_BITS)) & ((1 << ROW_TYPE_BITS) - 1);
+}
+
+static inline void row_set_type(Row *row, int col, BlockType type) {
+    int shift = col * ROW_TYPE_BITS;
+    *row = (*row & ~((Row)((1u << ROW_TYPE_BITS) - 1) << shift)) | ((Row)type << shift);
+}
+
+// returns the mask of the columns that have a block
+static inline RowMask row_get_occupied(Row row) {
+    RowMask occupied = 0;
+    for(int col = 0; col < PANEL_COLS; col++) {
+        if(row_get_type(row, col) != BLOCK_NONE) occupied |= 1 << col;
+    }
+    return occupied;
+}
+
+static inline RowMask row_get_falling(Row row) {
+    return (row >> ROW_FALLING_SHIFT) & ROW_MASK;
+}
+
+static inline void row_set_falling(Row *row, RowMask falling) {
+    *row = (*row & ~((Row)ROW_MASK << ROW_FALLING_SHIFT)) | ((Row)falling << ROW_FALLING_SHIFT);
+}
+
+static inline RowMask row_get_combo(Row row) {
+    return (row >> ROW_COMBO_SHIFT) & ROW_MASK;
+}
+
+static inline void row_set_combo(Row *row, RowMask combo) {
+    *row = (*row & ~((Row)ROW_MASK << ROW_COMBO_SHIFT)) | ((Row)combo << ROW_COMBO_SHIFT);
+}
+
+static inline RowMask row_get_landed(Row row) {
+    return (row >> ROW_LANDED_SHIFT) & ROW_MASK;
+}
+
+static inline void row_set_landed(Row *row, RowMask landed) {
+    *row = (*row & ~((Row)ROW_MASK << ROW_LANDED_SHIFT)) | ((Row)landed << ROW_LANDED_SHIFT);
+}
+
+typedef struct {
+    int row;
+    int col;
+} ComboCell;
+
+// the rows from `from` to `to`, both included
+typedef struct {
+    int from;
+    int to;
+} RowSpan;
+
+// a group of touching blocks of the same type cleared in the same tick
+typedef struct {
+    BlockType type;
+    int chain; // 1 for the first clear, it increases with every clear made while the previous blocks still fall
+    size_t size;
+    ComboCell *cells; // size cells
+} ComboEvent;
+
+typedef struct {
+    ComboEvent *items;
+    size_t count;
+} ComboEvents;
+
+typedef struct {
+    // NOTE: the panel blocks are stored from bottom to top, it means that the logical row 0 is the bottom row in
+    // the panel. The rows live in a ring buffer of fixed capacity that is never reallocated, the logical row N is
+    // stored at items[(head + N) & (capacity - 1)], so push_row_bottom only moves head to make the panel rise.
+    struct {
+        Row *items;
+        size_t head; // index in items of the bottom row
+        size_t count;
+        size_t capacity; // always a power of two
+    } rows;
+
+    struct {
+        int x;
+        int y;
+    } cursor;
+
+    Rng rng; // used to generate the rows of the panel
+
+    int gravityTimer; // ticks since the last gravity step
+    int riseTimer; // ticks since the last row was pushed at the bottom
+    bool toppedOut; // the stack reached the top when it had to rise, the panel doesn't change anymore
+    int heights[PANEL_COLS]; // height of the settled (not falling) stack of every column, updated by the gravity
+
+    int chain; // depth of the current chain, it grows with every clear made by blocks that just landed
+    ComboEvents events; // combos cleared in the last tick, they live in the arena passed to update_panel
+
+    uint64_t hash; // zobrist hash of the block types, updated with every block that changes
+
+    // spans of rows modified since the last combo check, sorted and far enough apart that the rows searched around
+    // them don't touch, combos are only searched around these rows
+    struct {
+        RowSpan items[PANEL_DIRTY_SPANS + 1]; // one more to insert a span before merging
+        int count;
+    } dirty;
+} Panel;
+
+// allocates the rows of the panel, rowCapacity is rounded up to a power of two
+void panel_init(Panel *panel, size_t rowCapacity);
+// uses rows as the ring buffer of the panel, capacity must be a power of two (panel_free must not be called)
+void panel_init_storage(Panel *panel, Row *rows, size_t capacity);
+void panel_free(Panel *panel); // frees the rows of the panel
+
+void panel_seed(Panel *panel, uint64_t seed, uint64_t stream); // seeds the rng of the panel
+// returns a row full of random blocks that doesn't form a combo by itself or with near and far, where near is the
+// row next to the new one and far the one after it (use 0 when they don't exist)
+Row generate_row(Rng *rng, Row near, Row far);
+bool row_has_match(Row row, Row near, Row far); // checks if row forms a combo by itself or with near and far
+// adds count random rows on top of the panel, returns how many were added before it was full
+size_t generate_rows(Panel *panel, size_t count);
+
+void mark_row_dirty(Panel *panel, int row);
+void mark_rows_dirty(Panel *panel, int from, int to); // marks the rows from `from` to `to` as a single span
+bool append_row(Panel *panel, Row row); // adds a row on top, returns false if the panel is full
+// adds a row at the bottom moving every row one up, returns false without changing anything if the panel is full
+// (the stack topped out)
+bool push_row_bottom(Panel *panel, Row row);
+void trim_empty_rows(Panel *panel); // recycles the empty rows at the top
+
+// returns the logical row without checking the bounds
+static inline Row *panel_row(Panel *panel, int row) {
+    return &panel->rows.items[(panel->rows.head + row) & (panel->rows.capacity - 1)];
+}
+
+// zobrist key of a block, 0 for BLOCK_NONE so the holes don't change the hash
+uint64_t zobrist_key(int row, int col, BlockType type);
+void panel_rehash(Panel *panel); // recomputes the hash, needed after setting the rows without the panel functions
+
+bool is_block_outbounds(Panel *panel, int row, int col);
+Row *get_row(Panel *panel, int row); // returns NULL if the row is out of bounds
+BlockType get_block(Panel *panel, int row, int col); // returns BLOCK_NONE if the block is out of bounds
+
+void swap_blocks(Panel *panel);
+void update_cursor(Panel *panel, Input input);
+// clears the combos, if arena is not NULL they are reported in panel->events
+void update_combos(Panel *panel, Arena *arena);
+void update_gravity(Panel *panel); // moves the falling blocks one block down every GRAVITY_TICKS
+void gravity_step(Panel *panel); // moves the falling blocks one block down right away
+// pushes a new row at the bottom every RISE_TICKS, the panel tops out if the stack fills the visible rows
+void update_rise(Panel *panel);
+void settle_panel(Panel *panel); // drops every block to its final position right away
+// advances the panel simulation by one tick, the combo events are allocated in arena (it can be NULL)
+// NOTE: the caller is expected to arena_clear the arena before every tick
+void update_panel(Panel *panel, Input input, Arena *arena);
+
+// a copy of the whole simulation state of a panel that doesn't own any memory, so it can live in any buffer
+typedef struct {
+    Panel panel; // the rows of this panel aren't valid
+    Row rows[]; // panel.rows.count rows from the bottom
+} PanelSnapshot;
+
+size_t panel_snapshot_size(Panel *panel); // bytes needed to save the panel
+// saves the panel in buffer, which needs at least panel_snapshot_size bytes, and returns it as a snapshot
+PanelSnapshot *panel_snapshot(Panel *panel, void *buffer);
+PanelSnapshot *panel_snapshot_arena(Panel *panel, Arena *arena); // saves the panel in memory of the arena
+// puts the snapshot state in the panel without allocating, it fails if the rows don't fit in the panel
+bool panel_restore(Panel *panel, PanelSnapshot *snapshot);
+
+// returns a checksum of the whole simulation state, two panels with the same checksum behave the same
+uint64_t panel_checksum(Panel *panel);
+
+#endif // PANEL_H
@@ -0,0 +1,102 @@
+#include "CCFuncs.h"
+#include "panel_set.h"
+
+#define PANEL_SET_ARENA_SIZE (64 * 1024)
+#define CACHE_LINE_SIZE 64
+
+typedef struct {
+    PanelSet *set;
+    Input *inputs;
+} UpdateJob;
+
+// first panel of the slice of worker, the last worker ends at count
+static size_t slice_start(PanelSet *set, size_t worker, size_t workerCount) {
+    size_t start = set->count * worker / workerCount;
+    start = (start + set->sliceStep - 1) / set->sliceStep * set->sliceStep;
+    return MIN(start, set->count);
+}
+
+// memory that starts at a cache line and fills its last one, so nothing else shares its lines
+static void *alloc_cache_lines(size_t size) {
+    // aligned_alloc needs a size multiple of the alignment
+    size = MAX((size + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1), CACHE_LINE_SIZE);
+    void *data = aligned_alloc(CACHE_LINE_SIZE, size);
+    assert(data != NULL && "Not enough memory");
+    memset(data, 0, size);
+    return data;
+}
+
+static void update_slice(void *ctx, size_t worker, size_t workerCount) {
+    UpdateJob *job = ctx;
+    PanelSet *set = job->set;
+
+    Arena *arena = set->arenas[worker];
+    arena_clear(arena);
+
+    size_t start = slice_start(set, worker, workerCount);
+    size_t end = slice_start(set, worker + 1, workerCount);
+
+    for(size_t i = start; i < end; i++) {
+        update_panel(&set->items[i], job->inputs != NULL ? job->inputs[i] : 0, arena);
+    }
+}
+
+PanelSet *panel_set_create(size_t count, size_t rowCapacity, size_t workerCount) {
+    size_t capacity = 1;
+    while(capacity < rowCapacity) capacity *= 2;
+
+    PanelSet *set = calloc(1, sizeof(PanelSet));
+    assert(set != NULL && "Not enough memory");
+
+    set->count = count;
+    set->rowCapacity = capacity;
+    set->items = alloc_cache_lines(count * sizeof(Panel));
+    set->rows = alloc_cache_lines(count * capacity * sizeof(Row));
+
+    // the smallest number of panels whose items and rows both end at a cache line
+    set->sliceStep = 1;
+    while((set->sliceStep * sizeof(Panel)) % CACHE_LINE_SIZE != 0
+          || (set->sliceStep * capacity * sizeof(Row)) % CACHE_LINE_SIZE != 0) {
+        set->sliceStep++;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        panel_init_storage(&set->items[i], &set->rows[i * capacity], capacity);
+    }
+
+    set->pool = thread_pool_create(workerCount);
+
+    set->arenas = calloc(set->pool->workerCount, sizeof(Arena*));
+    assert(set->arenas != NULL && "Not enough memory");
+    for(size_t i = 0; i < set->pool->workerCount; i++) {
+        set->arenas[i] = arena_create(PANEL_SET_ARENA_SIZE);
+    }
+
+    return set;
+}
+
+void panel_set_free(PanelSet *set) {
+    for(size_t i = 0; i < set->pool->workerCount; i++) {
+        arena_free(set->arenas[i]);
+    }
+    free(set->arenas);
+
+    thread_pool_free(set->pool);
+    free(set->rows);
+    free(set->items);
+    free(set);
+}
+
+void panel_set_seed(PanelSet *set, uint64_t seed) {
+    for(size_t i = 0; i < set->count; i++) {
+        panel_seed(&set->items[i], seed, i);
+    }
+}
+
+void panel_set_update(PanelSet *set, Input *inputs) {
+    UpdateJob job = {
+        .set = set,
+        .inputs = inputs,
+    };
+    thread_pool_run(set->pool, update_slice, &job);
+}
@@ -0,0 +1,34 @@
+#ifndef PANEL_SET_H
+#define PANEL_SET_H
+
+#include "panel.h"
+#include "thread_pool.h"
+
+// many independent panels stored contiguously and updated in parallel, every worker of the pool owns a slice of
+// the panels so they don't share any mutable state
+typedef struct {
+    Panel *items;
+    size_t count;
+
+    Row *rows; // the rows of every panel, panel i uses the rowCapacity rows starting at i * rowCapacity
+    size_t rowCapacity;
+
+    // the slices start at a multiple of this number of panels, so two workers never write to the same cache line of
+    // items or rows
+    size_t sliceStep;
+
+    ThreadPool *pool;
+    Arena **arenas; // one per worker, they hold the combo events of the panels of the worker until the next update
+} PanelSet;
+
+// rowCapacity is rounded up to a power of two, a workerCount of 0 uses one worker per core
+PanelSet *panel_set_create(size_t count, size_t rowCapacity, size_t workerCount);
+void panel_set_free(PanelSet *set);
+
+// seeds every panel with the same seed but a different stream so all of them are independent
+void panel_set_seed(PanelSet *set, uint64_t seed);
+
+// advances every panel by one tick, inputs[i] is the input of the panel i (inputs can be NULL)
+void panel_set_update(PanelSet *set, Input *inputs);
+
+#endif // PANEL_SET_H
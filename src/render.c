@@ -0,0 +1,137 @@
+#include "raylib.h"
+#include "rlgl.h"
+#include "render.h"
+
+#define CURSOR_THICKNESS 5
+#define OVERLAY_FONT_SIZE 20
+#define TOPPED_OUT_FONT_SIZE 40
+#define TOPPED_OUT_TEXT "TOPPED OUT"
+
+// this colors are in the same order as the BlockType enum
+const Color BLOCK_COLORS[] = {{0, 0, 0, 0}, YELLOW, GREEN, BLUE, RED, PURPLE};
+
+// NOTE: every quad is pushed to the default render batch of rlgl between a single rlBegin/rlEnd pair with the default
+// texture, that way all the blocks and cursors of every panel end up in the same draw call instead of one
+// DrawRectangle call per block. The default texture is a single white pixel so the texcoords don't matter.
+static void push_quad(float x, float y, float width, float height, Color color) {
+    rlCheckRenderBatchLimit(4);
+
+    rlColor4ub(color.r, color.g, color.b, color.a);
+    rlVertex2f(x, y);
+    rlVertex2f(x, y + height);
+    rlVertex2f(x + width, y + height);
+    rlVertex2f(x + width, y);
+}
+
+static void push_panel_quads(Panel *panel, Rectangle bounds, float tickAlpha) {
+    Vector2 blockSize = {
+        .x = bounds.width / PANEL_COLS,
+        .y = bounds.height / PANEL_ROWS,
+    };
+
+    // falling blocks move one block down every gravity step
+    float fallOffset = (panel->gravityTimer + tickAlpha) / GRAVITY_TICKS * blockSize.y;
+
+    // the rows above the visible ones would be drawn outside of the bounds
+    int visibleRows = MIN((int)panel->rows.count, PANEL_ROWS);
+
+    for(int row = 0; row < visibleRows; row++) {
+        Row r = *panel_row(panel, row);
+        RowMask falling = row_get_falling(r);
+
+        for(int col = 0; col < PANEL_COLS; col++) {
+            BlockType type = row_get_type(r, col);
+            if(type == BLOCK_NONE) continue;
+
+            int x = bounds.x + col * blockSize.x;
+            int y = bounds.y + bounds.height - (row + 1) * blockSize.y;
+            if(falling & (1 << col)) y += fallOffset;
+
+            push_quad(x, y, (int)blockSize.x, (int)blockSize.y, BLOCK_COLORS[type]);
+        }
+    }
+
+    // the cursor outline is made of four quads like DrawRectangleLinesEx does
+    Rectangle cursorRec = {
+        .x = bounds.x + panel->cursor.x * blockSize.x,
+        .y = bounds.y + panel->cursor.y * blockSize.y,
+        .width = blockSize.x * 2,
+        .height = blockSize.y,
+    };
+    float t = CURSOR_THICKNESS;
+    push_quad(cursorRec.x, cursorRec.y, cursorRec.width, t, WHITE);
+    push_quad(cursorRec.x, cursorRec.y + cursorRec.height - t, cursorRec.width, t, WHITE);
+    push_quad(cursorRec.x, cursorRec.y + t, t, cursorRec.height - t * 2, WHITE);
+    push_quad(cursorRec.x + cursorRec.width - t, cursorRec.y + t, t, cursorRec.height - t * 2, WHITE);
+}
+
+void draw_panels(Panel *panels, Rectangle *bounds, size_t count, float tickAlpha) {
+    // rlSetTexture(0) keeps the texture of the current draw call, like the font of a previous DrawText, so the
+    // default texture is selected explicitly
+    rlSetTexture(rlGetTextureIdDefault());
+    rlBegin(RL_QUADS);
+
+    for(size_t i = 0; i < count; i++) {
+        push_panel_quads(&panels[i], bounds[i], tickAlpha);
+    }
+
+    rlEnd();
+    rlSetTexture(0);
+
+    for(size_t i = 0; i < count; i++) {
+        if(!panels[i].toppedOut) continue;
+
+        int width = MeasureText(TOPPED_OUT_TEXT, TOPPED_OUT_FONT_SIZE);
+        int x = bounds[i].x + (bounds[i].width - width) / 2;
+        int y = bounds[i].y + (bounds[i].height - TOPPED_OUT_FONT_SIZE) / 2;
+        DrawText(TOPPED_OUT_TEXT, x, y, TOPPED_OUT_FONT_SIZE, WHITE);
+    }
+}
+
+void draw_panel(Panel *panel, Rectangle bounds, float tickAlpha) {
+    draw_panels(panel, &bounds, 1, tickAlpha);
+}
+
+int draw_profiler_overlay(int x, int y) {
+    ProfileStats stats[PROFILER_MAX_ZONES];
+    size_t count = profiler_get_stats(stats, PROFILER_MAX_ZONES);
+
+    DrawText("zone: min / avg / p99 (ms)", x, y, OVERLAY_FONT_SIZE, LIGHTGRAY);
+
+    for(size_t i = 0; i < count; i++) {
+        const char *text = TextFormat("%s: %.3f / %.3f / %.3f", stats[i].name, stats[i].minMs, stats[i].avgMs, stats[i].p99Ms);
+        DrawText(text, x, y + (i + 1) * OVERLAY_FONT_SIZE, OVERLAY_FONT_SIZE, LIGHTGRAY);
+    }
+
+    return y + (count + 1) * OVERLAY_FONT_SIZE;
+}
+
+int draw_arena_overlay(const char *name, Arena *arena, int x, int y) {
+    ArenaStats stats = arena_stats(arena);
+
+    const char *lines[] = {
+        TextFormat("%s: %zu regions in use of %zu (%zu KB)", name, stats.regionsInUse, stats.regionCount,
+            stats.reservedBytes / 1024),
+        TextFormat("used: %zu B, peak: %zu B, high water: %zu B", stats.usedBytes, stats.peakBytes,
+            stats.highWaterBytes),
+        TextFormat("wasted tails: %zu B", stats.wastedBytes),
+    };
+
+    for(size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+        DrawText(lines[i], x, y + i * OVERLAY_FONT_SIZE, OVERLAY_FONT_SIZE, LIGHTGRAY);
+    }
+    y += sizeof(lines) / sizeof(lines[0]) * OVERLAY_FONT_SIZE;
+
+    // the waste of every region in use with the allocation that caused it, to choose the regionSize
+    for(size_t i = 0; i < stats.regionsInUse; i++) {
+        RegionStats region = arena_region_stats(arena, i);
+        const char *text = region.overflowSize > 0
+            ? TextFormat("  region %zu: %zu / %zu B, wasted %zu B by a %zu B alloc", i, region.usedBytes,
+                region.capacity, region.wastedBytes, region.overflowSize)
+            : TextFormat("  region %zu: %zu / %zu B", i, region.usedBytes, region.capacity);
+        DrawText(text, x, y, OVERLAY_FONT_SIZE, LIGHTGRAY);
+        y += OVERLAY_FONT_SIZE;
+    }
+
+    return y;
+}
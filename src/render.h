@@ -0,0 +1,19 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "raylib.h"
+#include "panel.h"
+
+// bounds is the area of the screen where the panel is drawn
+// tickAlpha is the fraction of a tick elapsed since the last simulated one, it's used to interpolate the falling blocks
+void draw_panel(Panel *panel, Rectangle bounds, float tickAlpha);
+
+// draws many panels at once, bounds[i] is the area of panels[i]
+void draw_panels(Panel *panels, Rectangle *bounds, size_t count, float tickAlpha);
+
+// draws the min/avg/p99 frame time of every profiler zone with the top left corner at x, y, returns the y below it
+int draw_profiler_overlay(int x, int y);
+// draws the usage of an arena (see arena_stats) with the top left corner at x, y, returns the y below it
+int draw_arena_overlay(const char *name, Arena *arena, int x, int y);
+
+#endif // RENDER_H
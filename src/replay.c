@@ -0,0 +1,139 @@
+#include "replay.h"
+
+static void write_u32(FILE *f, uint32_t n) {
+    uint8_t bytes[4];
+    le_put_u32(bytes, n);
+    fwrite(bytes, 1, sizeof(bytes), f);
+}
+
+static void write_u64(FILE *f, uint64_t n) {
+    uint8_t bytes[8];
+    le_put_u64(bytes, n);
+    fwrite(bytes, 1, sizeof(bytes), f);
+}
+
+static void write_leb128(FILE *f, uint64_t n) {
+    do {
+        uint8_t byte = n & 0x7f;
+        n >>= 7;
+        if(n != 0) byte |= 0x80;
+        fputc(byte, f);
+    } while(n != 0);
+}
+
+static bool read_u32(FILE *f, uint32_t *n) {
+    uint8_t bytes[4];
+    if(fread(bytes, 1, sizeof(bytes), f) != sizeof(bytes)) return false;
+
+    *n = le_get_u32(bytes);
+    return true;
+}
+
+static bool read_u64(FILE *f, uint64_t *n) {
+    uint8_t bytes[8];
+    if(fread(bytes, 1, sizeof(bytes), f) != sizeof(bytes)) return false;
+
+    *n = le_get_u64(bytes);
+    return true;
+}
+
+static bool read_leb128(FILE *f, uint64_t *n) {
+    *n = 0;
+    for(int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(f);
+        if(byte == EOF) return false;
+
+        *n |= (uint64_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+void replay_record(Replay *replay, Input input) {
+    da_append(&replay->inputs, input);
+}
+
+bool replay_save(Replay *replay, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if(f == NULL) {
+        log_error("Couldn't open the replay file \"%s\"", path);
+        return false;
+    }
+
+    fwrite(REPLAY_MAGIC, 1, 4, f);
+    write_u32(f, REPLAY_VERSION);
+    write_u64(f, replay->seed);
+    write_u32(f, replay->startRows);
+    write_u64(f, replay->inputs.count);
+
+    // most ticks have no input, so runs of the same input take very little space
+    for(size_t i = 0; i < replay->inputs.count;) {
+        Input input = replay->inputs.items[i];
+        size_t run = 1;
+        while(i + run < replay->inputs.count && replay->inputs.items[i + run] == input) run++;
+
+        fputc(input, f);
+        write_leb128(f, run);
+        i += run;
+    }
+
+    bool ok = !ferror(f);
+    if(fclose(f) != 0) ok = false;
+
+    if(!ok) log_error("Couldn't write the replay file \"%s\"", path);
+    return ok;
+}
+
+bool replay_load(Replay *replay, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if(f == NULL) {
+        log_error("Couldn't open the replay file \"%s\"", path);
+        return false;
+    }
+
+    char magic[4];
+    uint32_t version;
+    uint64_t tickCount;
+
+    if(fread(magic, 1, 4, f) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0
+       || !read_u32(f, &version) || version != REPLAY_VERSION
+       || !read_u64(f, &replay->seed) || !read_u32(f, &replay->startRows) || !read_u64(f, &tickCount)) {
+        log_error("The file \"%s\" isn't a valid replay", path);
+        fclose(f);
+        return false;
+    }
+
+    replay->inputs.count = 0;
+    while(replay->inputs.count < tickCount) {
+        int input = fgetc(f);
+        uint64_t run;
+
+        if(input == EOF || !read_leb128(f, &run) || run > tickCount - replay->inputs.count) {
+            log_error("The replay \"%s\" is truncated (tick %zu of %zu)", path, replay->inputs.count, (size_t)tickCount);
+            fclose(f);
+            return false;
+        }
+
+        for(uint64_t i = 0; i < run; i++) replay_record(replay, input);
+    }
+
+    fclose(f);
+    return true;
+}
+
+void replay_free(Replay *replay) {
+    da_free(&replay->inputs);
+}
+
+void replay_start_panel(Replay *replay, Panel *panel) {
+    panel_seed(panel, replay->seed, 0);
+    generate_rows(panel, replay->startRows);
+}
+
+void replay_run(Replay *replay, Panel *panel, size_t tick, size_t endTick) {
+    endTick = MIN(endTick, replay->inputs.count);
+
+    for(; tick < endTick; tick++) {
+        update_panel(panel, replay->inputs.items[tick], NULL);
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "panel.h"
+
+// Replay file format (every number is little endian):
+//   - magic "CPRP", u32 version
+//   - u64 seed, u32 rows the panel starts with, u64 number of ticks
+//   - the input of every tick, run length encoded as pairs of u8 input and LEB128 run length
+#define REPLAY_MAGIC "CPRP"
+#define REPLAY_VERSION 1
+
+// the inputs of every tick of a game, together with the seed they are enough to reproduce the whole game
+typedef struct {
+    uint64_t seed;
+    uint32_t startRows;
+
+    struct {
+        Input *items;
+        size_t count;
+        size_t capacity;
+    } inputs;
+} Replay;
+
+void replay_record(Replay *replay, Input input); // adds the input of the next tick
+bool replay_save(Replay *replay, const char *path);
+bool replay_load(Replay *replay, const char *path);
+void replay_free(Replay *replay);
+
+// sets up the starting state of the replay in a panel that was just initialized
+void replay_start_panel(Replay *replay, Panel *panel);
+// simulates the ticks from tick to endTick of the replay as fast as possible
+void replay_run(Replay *replay, Panel *panel, size_t tick, size_t endTick);
+
+#endif // REPLAY_H
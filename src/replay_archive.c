@@ -0,0 +1,256 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "replay_archive.h"
+
+#define HEADER_SIZE 56
+
+// BYTE BUFFER //
+typedef struct {
+    uint8_t *items;
+    size_t count;
+    size_t capacity;
+} ByteBuffer;
+
+static void put_u32(ByteBuffer *buf, uint32_t n) {
+    uint8_t bytes[4];
+    le_put_u32(bytes, n);
+    da_append_many(buf, bytes, sizeof(bytes));
+}
+
+static void put_u64(ByteBuffer *buf, uint64_t n) {
+    uint8_t bytes[8];
+    le_put_u64(bytes, n);
+    da_append_many(buf, bytes, sizeof(bytes));
+}
+
+// KEYFRAMES //
+
+// u64 tick, u32 row count, i32 cursor x and y, u64 rng state and inc, i32 gravity timer, i32 chain, i32 rise timer,
+// u32 topped out, u32 dirty span count, i32 from and to of PANEL_DIRTY_SPANS dirty spans, i32 height of every column and a u32 per row from the bottom
+#define KEYFRAME_HEADER_SIZE (8 + 4 + 4 * 2 + 8 * 2 + 4 * 4 + 4 + 8 * PANEL_DIRTY_SPANS + 4 * PANEL_COLS)
+
+static void put_keyframe(ByteBuffer *buf, Panel *panel, uint64_t tick) {
+    put_u64(buf, tick);
+    put_u32(buf, panel->rows.count);
+    put_u32(buf, panel->cursor.x);
+    put_u32(buf, panel->cursor.y);
+    put_u64(buf, panel->rng.state);
+    put_u64(buf, panel->rng.inc);
+    put_u32(buf, panel->gravityTimer);
+    put_u32(buf, panel->chain);
+    put_u32(buf, panel->riseTimer);
+    put_u32(buf, panel->toppedOut);
+    put_u32(buf, panel->dirty.count);
+    for(int i = 0; i < PANEL_DIRTY_SPANS; i++) {
+        put_u32(buf, panel->dirty.items[i].from);
+        put_u32(buf, panel->dirty.items[i].to);
+    }
+
+    for(int col = 0; col < PANEL_COLS; col++) {
+        put_u32(buf, panel->heights[col]);
+    }
+
+    for(int row = 0; row < panel->rows.count; row++) {
+        put_u32(buf, *panel_row(panel, row));
+    }
+}
+
+// loads the keyframe that has to be at tick, the fields that index the rows are checked before changing the panel
+static bool load_keyframe(ReplayArchive *archive, const uint8_t *data, Panel *panel, uint64_t tick) {
+    uint32_t rowCount = le_get_u32(data + 8);
+    if(data + KEYFRAME_HEADER_SIZE + rowCount * 4 > archive->data + archive->size) {
+        log_error("Keyframe out of the bounds of the archive (%u rows)", rowCount);
+        return false;
+    }
+
+    if(rowCount > panel->rows.capacity) {
+        log_error("The keyframe has %u rows but the panel only fits %zu", rowCount, panel->rows.capacity);
+        return false;
+    }
+
+    uint64_t keyframeTick = le_get_u64(data);
+    if(keyframeTick != tick) {
+        log_error("The keyframe of the tick %zu is at the tick %zu", (size_t)tick, (size_t)keyframeTick);
+        return false;
+    }
+
+    uint32_t dirtyCount = le_get_u32(data + 52);
+    RowSpan dirty[PANEL_DIRTY_SPANS];
+
+    const uint8_t *p = data + 56;
+    for(int i = 0; i < PANEL_DIRTY_SPANS; i++, p += 8) {
+        dirty[i].from = (int32_t)le_get_u32(p);
+        dirty[i].to = (int32_t)le_get_u32(p + 4);
+    }
+
+    bool validDirty = dirtyCount <= PANEL_DIRTY_SPANS;
+    for(uint32_t i = 0; validDirty && i < dirtyCount; i++) {
+        validDirty = dirty[i].from >= 0 && dirty[i].from <= dirty[i].to && dirty[i].to < (int)rowCount;
+    }
+
+    if(!validDirty) {
+        log_error("The keyframe of the tick %zu has dirty rows out of its %u rows", (size_t)tick, rowCount);
+        return false;
+    }
+
+    panel->cursor.x = (int32_t)le_get_u32(data + 12);
+    panel->cursor.y = (int32_t)le_get_u32(data + 16);
+    panel->rng.state = le_get_u64(data + 20);
+    panel->rng.inc = le_get_u64(data + 28);
+    panel->gravityTimer = (int32_t)le_get_u32(data + 36);
+    panel->chain = (int32_t)le_get_u32(data + 40);
+    panel->riseTimer = (int32_t)le_get_u32(data + 44);
+    panel->toppedOut = le_get_u32(data + 48) != 0;
+    panel->dirty.count = dirtyCount;
+    memcpy(panel->dirty.items, dirty, sizeof(dirty));
+
+    for(int col = 0; col < PANEL_COLS; col++, p += 4) {
+        panel->heights[col] = (int32_t)le_get_u32(p);
+    }
+
+    panel->rows.head = 0;
+    panel->rows.count = rowCount;
+    for(uint32_t row = 0; row < rowCount; row++, p += 4) {
+        *panel_row(panel, row) = le_get_u32(p);
+    }
+    panel_rehash(panel);
+
+    panel->events.items = NULL;
+    panel->events.count = 0;
+    return true;
+}
+
+bool replay_archive_write(Replay *replay, const char *path, uint32_t keyframeInterval) {
+    ByteBuffer buf = {0};
+    ByteBuffer index = {0};
+    uint64_t keyframeCount = replay->inputs.count / keyframeInterval + 1;
+
+    // the offsets are set once they are known
+    for(int i = 0; i < 4; i++) da_append(&buf, (uint8_t)REPLAY_ARCHIVE_MAGIC[i]);
+    put_u32(&buf, REPLAY_ARCHIVE_VERSION);
+    put_u64(&buf, replay->seed);
+    put_u32(&buf, replay->startRows);
+    put_u32(&buf, keyframeInterval);
+    put_u64(&buf, replay->inputs.count);
+    put_u64(&buf, keyframeCount);
+    put_u64(&buf, 0);
+    put_u64(&buf, 0);
+    assert(buf.count == HEADER_SIZE);
+
+    le_put_u64(buf.items + 40, buf.count);
+    da_append_many(&buf, replay->inputs.items, replay->inputs.count);
+
+    Panel panel = {0};
+    panel_init(&panel, PANEL_ROW_CAPACITY);
+    replay_start_panel(replay, &panel);
+
+    for(uint64_t k = 0; k < keyframeCount; k++) {
+        uint64_t tick = k * keyframeInterval;
+        replay_run(replay, &panel, tick == 0 ? 0 : tick - keyframeInterval, tick);
+
+        put_u64(&index, buf.count);
+        put_keyframe(&buf, &panel, tick);
+    }
+    panel_free(&panel);
+
+    le_put_u64(buf.items + 48, buf.count);
+    da_append_many(&buf, index.items, index.count);
+
+    bool ok = false;
+    FILE *f = fopen(path, "wb");
+    if(f != NULL) {
+        ok = fwrite(buf.items, 1, buf.count, f) == buf.count;
+        if(fclose(f) != 0) ok = false;
+    }
+
+    if(!ok) log_error("Couldn't write the replay archive \"%s\"", path);
+
+    da_free(&buf);
+    da_free(&index);
+    return ok;
+}
+
+bool replay_archive_open(ReplayArchive *archive, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) {
+        log_error("Couldn't open the replay archive \"%s\"", path);
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < HEADER_SIZE) {
+        log_error("The file \"%s\" isn't a valid replay archive", path);
+        close(fd);
+        return false;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(data == MAP_FAILED) {
+        log_error("Couldn't map the replay archive \"%s\"", path);
+        return false;
+    }
+
+    archive->data = data;
+    archive->size = st.st_size;
+
+    uint8_t *h = archive->data;
+    archive->seed = le_get_u64(h + 8);
+    archive->startRows = le_get_u32(h + 16);
+    archive->keyframeInterval = le_get_u32(h + 20);
+    archive->tickCount = le_get_u64(h + 24);
+    archive->keyframeCount = le_get_u64(h + 32);
+    uint64_t inputsOffset = le_get_u64(h + 40);
+    uint64_t indexOffset = le_get_u64(h + 48);
+
+    if(memcmp(h, REPLAY_ARCHIVE_MAGIC, 4) != 0 || le_get_u32(h + 4) != REPLAY_ARCHIVE_VERSION
+       || archive->keyframeInterval == 0 || archive->keyframeCount == 0
+       || inputsOffset + archive->tickCount > archive->size
+       || indexOffset + archive->keyframeCount * 8 > archive->size) {
+        log_error("The file \"%s\" isn't a valid replay archive", path);
+        replay_archive_close(archive);
+        return false;
+    }
+
+    archive->inputs = archive->data + inputsOffset;
+    archive->index = archive->data + indexOffset;
+    return true;
+}
+
+void replay_archive_close(ReplayArchive *archive) {
+    munmap(archive->data, archive->size);
+    archive->data = NULL;
+    archive->size = 0;
+}
+
+bool replay_archive_seek(ReplayArchive *archive, Panel *panel, uint64_t tick) {
+    if(tick > archive->tickCount) {
+        log_error("Tick %zu is after the end of the replay (%zu ticks)", (size_t)tick, (size_t)archive->tickCount);
+        return false;
+    }
+
+    uint64_t k = MIN(tick / archive->keyframeInterval, archive->keyframeCount - 1);
+    uint64_t offset = le_get_u64(archive->index + k * 8);
+    if(offset + KEYFRAME_HEADER_SIZE > archive->size) {
+        log_error("The keyframe %zu is out of the bounds of the archive", (size_t)k);
+        return false;
+    }
+
+    // the inputs after the keyframe are read without checks, so the keyframe can't be after tick
+    uint64_t keyframeTick = k * archive->keyframeInterval;
+    if(keyframeTick > tick || tick > archive->tickCount) {
+        log_error("The keyframe %zu can't be used to reach the tick %zu", (size_t)k, (size_t)tick);
+        return false;
+    }
+
+    if(!load_keyframe(archive, archive->data + offset, panel, keyframeTick)) return false;
+
+    for(uint64_t t = keyframeTick; t < tick; t++) {
+        update_panel(panel, archive->inputs[t], NULL);
+    }
+
+    return true;
+}
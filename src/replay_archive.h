@@ -0,0 +1,41 @@
+#ifndef REPLAY_ARCHIVE_H
+#define REPLAY_ARCHIVE_H
+
+#include "panel.h"
+#include "replay.h"
+
+// Replay archive format, made to jump to any tick of long replays (every number is little endian):
+//   - header: magic "CPRA", u32 version, u64 seed, u32 start rows, u32 keyframe interval, u64 number of ticks,
+//     u64 number of keyframes, u64 offset of the inputs, u64 offset of the keyframe index
+//   - inputs: one u8 per tick so the input of any tick can be read directly
+//   - keyframes: the full state of the panel every keyframe interval ticks, starting at the tick 0
+//   - keyframe index: the u64 offset of every keyframe
+#define REPLAY_ARCHIVE_MAGIC "CPRA"
+#define REPLAY_ARCHIVE_VERSION 5
+#define REPLAY_ARCHIVE_INTERVAL (TICK_RATE * 10) // default ticks between keyframes
+
+// an archive opened with mmap, nothing is read until it's needed
+typedef struct {
+    uint8_t *data;
+    size_t size;
+
+    uint64_t seed;
+    uint32_t startRows;
+    uint32_t keyframeInterval;
+    uint64_t tickCount;
+    uint64_t keyframeCount;
+    const uint8_t *inputs;
+    const uint8_t *index;
+} ReplayArchive;
+
+// simulates the replay saving a keyframe every keyframeInterval ticks
+bool replay_archive_write(Replay *replay, const char *path, uint32_t keyframeInterval);
+
+bool replay_archive_open(ReplayArchive *archive, const char *path);
+void replay_archive_close(ReplayArchive *archive);
+
+// puts in the panel the state after tick ticks, loading the nearest keyframe and simulating the rest.
+// The panel has to be initialized, it fails if its capacity is too small for the keyframe
+bool replay_archive_seek(ReplayArchive *archive, Panel *panel, uint64_t tick);
+
+#endif // REPLAY_ARCHIVE_H
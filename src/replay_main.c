@@ -0,0 +1,84 @@
+// Headless replay player, it simulates a replay as fast as possible and prints the final state of the panel.
+// Usage:
+//   replay <file.rpl>                    simulates the whole replay
+//   replay --archive <file.rpl> <out.rpa> writes a replay archive with keyframes
+//   replay --seek <file.rpa> <tick>       prints the state at the tick using the archive keyframes
+
+#include <stdio.h>
+
+#include "CCFuncs.h"
+#include "panel.h"
+#include "replay.h"
+#include "replay_archive.h"
+
+static const char BLOCK_CHARS[] = ".YGBRP"; // in the same order as the BlockType enum
+
+static void print_panel(Panel *panel) {
+    for(int row = panel->rows.count - 1; row >= 0; row--) {
+        for(int col = 0; col < PANEL_COLS; col++) {
+            putchar(BLOCK_CHARS[get_block(panel, row, col)]);
+        }
+        putchar('\n');
+    }
+}
+
+static void print_state(Panel *panel, size_t ticks, double elapsed) {
+    print_panel(panel);
+    printf("ticks: %zu\n", ticks);
+    printf("checksum: %016llx\n", (unsigned long long)panel_checksum(panel));
+    printf("time: %.3f ms\n", elapsed * 1000);
+}
+
+static int write_archive(const char *replayPath, const char *archivePath) {
+    Replay replay = {0};
+    if(!replay_load(&replay, replayPath)) return 1;
+
+    bool ok = replay_archive_write(&replay, archivePath, REPLAY_ARCHIVE_INTERVAL);
+    replay_free(&replay);
+    return ok ? 0 : 1;
+}
+
+static int seek_archive(const char *archivePath, uint64_t tick) {
+    ReplayArchive archive = {0};
+    if(!replay_archive_open(&archive, archivePath)) return 1;
+
+    Panel panel = {0};
+    panel_init(&panel, PANEL_ROW_CAPACITY);
+
+    uint64_t start = profiler_now();
+    bool ok = replay_archive_seek(&archive, &panel, tick);
+    double elapsed = (profiler_now() - start) / 1e9;
+
+    if(ok) print_state(&panel, tick, elapsed);
+
+    panel_free(&panel);
+    replay_archive_close(&archive);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    if(argc == 4 && strcmp(argv[1], "--archive") == 0) return write_archive(argv[2], argv[3]);
+    if(argc == 4 && strcmp(argv[1], "--seek") == 0) return seek_archive(argv[2], strtoull(argv[3], NULL, 10));
+
+    if(argc != 2) {
+        fprintf(stderr, "usage: %s <file.rpl> | --archive <file.rpl> <out.rpa> | --seek <file.rpa> <tick>\n", argv[0]);
+        return 1;
+    }
+
+    Replay replay = {0};
+    if(!replay_load(&replay, argv[1])) return 1;
+
+    Panel panel = {0};
+    panel_init(&panel, PANEL_ROW_CAPACITY);
+    replay_start_panel(&replay, &panel);
+
+    uint64_t start = profiler_now();
+    replay_run(&replay, &panel, 0, replay.inputs.count);
+    double elapsed = (profiler_now() - start) / 1e9;
+
+    print_state(&panel, replay.inputs.count, elapsed);
+
+    panel_free(&panel);
+    replay_free(&replay);
+    return 0;
+}
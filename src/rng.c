@@ -0,0 +1,30 @@
+#include "rng.h"
+
+void rng_seed(Rng *rng, uint64_t seed, uint64_t stream) {
+    rng->state = 0;
+    rng->inc = (stream << 1) | 1;
+    rng_next(rng);
+    rng->state += seed;
+    rng_next(rng);
+}
+
+uint32_t rng_next(Rng *rng) {
+    uint64_t old = rng->state;
+    rng->state = old * 6364136223846793005ULL + rng->inc;
+
+    uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+    uint32_t rot = old >> 59;
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+uint32_t rng_range(Rng *rng, uint32_t n) {
+    // Lemire's multiply and shift, the numbers below threshold are rejected so every result is equally likely
+    uint64_t m = (uint64_t)rng_next(rng) * n;
+    if((uint32_t)m < n) {
+        uint32_t threshold = -n % n;
+        while((uint32_t)m < threshold) {
+            m = (uint64_t)rng_next(rng) * n;
+        }
+    }
+    return m >> 32;
+}
@@ -0,0 +1,17 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// PCG32 random number generator (https://www.pcg-random.org), every Rng is an independent and reproducible stream
+typedef struct {
+    uint64_t state;
+    uint64_t inc; // selects the stream, always odd
+} Rng;
+
+// different streams with the same seed produce different sequences
+void rng_seed(Rng *rng, uint64_t seed, uint64_t stream);
+uint32_t rng_next(Rng *rng);
+uint32_t rng_range(Rng *rng, uint32_t n); // returns a number in [0, n) without modulo bias
+
+#endif // RNG_H
@@ -0,0 +1,106 @@
+#include <unistd.h>
+
+#include "CCFuncs.h"
+#include "thread_pool.h"
+
+typedef struct {
+    ThreadPool *pool;
+    size_t worker;
+} WorkerArgs;
+
+static void *worker_loop(void *arg) {
+    WorkerArgs args = *(WorkerArgs*)arg;
+    free(arg);
+
+    ThreadPool *pool = args.pool;
+    size_t generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    while(true) {
+        while(!pool->stop && pool->generation == generation) {
+            pthread_cond_wait(&pool->jobReady, &pool->mutex);
+        }
+
+        if(pool->stop) break;
+
+        generation = pool->generation;
+        ThreadPoolJob job = pool->job;
+        void *ctx = pool->ctx;
+        pthread_mutex_unlock(&pool->mutex);
+
+        job(ctx, args.worker, pool->workerCount);
+
+        pthread_mutex_lock(&pool->mutex);
+        if(--pool->pending == 0) pthread_cond_signal(&pool->jobDone);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+ThreadPool *thread_pool_create(size_t workerCount) {
+    if(workerCount == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        workerCount = cores > 0 ? cores : 1;
+    }
+
+    ThreadPool *pool = calloc(1, sizeof(ThreadPool));
+    assert(pool != NULL && "Not enough memory");
+
+    pool->workerCount = workerCount;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->jobReady, NULL);
+    pthread_cond_init(&pool->jobDone, NULL);
+
+    // the worker 0 is the thread that runs the job
+    pool->threads = calloc(workerCount, sizeof(pthread_t));
+    assert(pool->threads != NULL && "Not enough memory");
+
+    for(size_t i = 1; i < workerCount; i++) {
+        WorkerArgs *args = malloc(sizeof(WorkerArgs));
+        assert(args != NULL && "Not enough memory");
+        *args = (WorkerArgs) { .pool = pool, .worker = i };
+
+        if(pthread_create(&pool->threads[i], NULL, worker_loop, args) != 0) {
+            log_error("Couldn't create the thread %zu of the pool", i);
+            exit(1);
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_run(ThreadPool *pool, ThreadPoolJob job, void *ctx) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->job = job;
+    pool->ctx = ctx;
+    pool->pending = pool->workerCount - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->jobReady);
+    pthread_mutex_unlock(&pool->mutex);
+
+    job(ctx, 0, pool->workerCount);
+
+    pthread_mutex_lock(&pool->mutex);
+    while(pool->pending > 0) {
+        pthread_cond_wait(&pool->jobDone, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->jobReady);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for(size_t i = 1; i < pool->workerCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->jobDone);
+    pthread_cond_destroy(&pool->jobReady);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    free(pool);
+}
@@ -0,0 +1,31 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// a job runs once on every worker, worker goes from 0 to workerCount - 1 so the job can split its work in slices
+typedef void (*ThreadPoolJob)(void *ctx, size_t worker, size_t workerCount);
+
+// a pool of threads that stay alive between jobs, the thread that calls thread_pool_run works as the worker 0
+typedef struct {
+    pthread_t *threads;
+    size_t workerCount;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t jobReady;
+    pthread_cond_t jobDone;
+
+    ThreadPoolJob job;
+    void *ctx;
+    size_t generation; // incremented every time a job starts
+    size_t pending; // threads that haven't finished the current job
+    bool stop;
+} ThreadPool;
+
+ThreadPool *thread_pool_create(size_t workerCount); // a workerCount of 0 uses one worker per core
+void thread_pool_run(ThreadPool *pool, ThreadPoolJob job, void *ctx); // returns when every worker finished the job
+void thread_pool_free(ThreadPool *pool);
+
+#endif // THREAD_POOL_H
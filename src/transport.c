@@ -0,0 +1,180 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "CCFuncs.h"
+#include "transport.h"
+
+bool transport_send(Transport *transport, const uint8_t *data, size_t size) {
+    if(size > TRANSPORT_MAX_PACKET) {
+        log_error("The packet has %zu bytes but the max is %d", size, TRANSPORT_MAX_PACKET);
+        return false;
+    }
+    return transport->send(transport, data, size);
+}
+
+size_t transport_receive(Transport *transport, uint8_t *buffer, size_t capacity) {
+    return transport->receive(transport, buffer, capacity);
+}
+
+void transport_free(Transport *transport) {
+    transport->free(transport);
+}
+
+// UDP TRANSPORT //
+typedef struct {
+    Transport transport;
+    int socket;
+    bool failed; // a receive error that isn't a refused packet was already reported
+} UdpTransport;
+
+static bool udp_send(Transport *transport, const uint8_t *data, size_t size) {
+    UdpTransport *udp = (UdpTransport*)transport;
+
+    // the peer may not be listening yet, the lost packets are sent again by the caller
+    return send(udp->socket, data, size, 0) == size;
+}
+
+static size_t udp_receive(Transport *transport, uint8_t *buffer, size_t capacity) {
+    UdpTransport *udp = (UdpTransport*)transport;
+
+    while(true) {
+        ssize_t size = recv(udp->socket, buffer, capacity, 0);
+        if(size > 0) return size;
+
+        // a previous packet was rejected by the peer, there may be more packets after the error
+        if(size < 0 && errno == ECONNREFUSED) continue;
+
+        // any other error would happen again on every call, so it's only reported once
+        if(size < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !udp->failed) {
+            log_error("Couldn't receive from the socket: %s", strerror(errno));
+            udp->failed = true;
+        }
+        return 0;
+    }
+}
+
+static void udp_free(Transport *transport) {
+    UdpTransport *udp = (UdpTransport*)transport;
+    close(udp->socket);
+    free(udp);
+}
+
+Transport *udp_transport_create(uint16_t localPort, const char *remoteHost, uint16_t remotePort) {
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_DGRAM,
+    };
+    char port[8];
+    snprintf(port, sizeof(port), "%u", remotePort);
+
+    struct addrinfo *remote;
+    int error = getaddrinfo(remoteHost, port, &hints, &remote);
+    if(error != 0) {
+        log_error("Couldn't resolve %s: %s", remoteHost, gai_strerror(error));
+        return NULL;
+    }
+
+    int s = socket(AF_INET, SOCK_DGRAM, 0);
+    if(s < 0) {
+        log_error("Couldn't create the socket: %s", strerror(errno));
+        freeaddrinfo(remote);
+        return NULL;
+    }
+
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(localPort),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    // connecting the socket filters out the packets that don't come from the peer
+    bool ok = bind(s, (struct sockaddr*)&local, sizeof(local)) == 0
+        && connect(s, remote->ai_addr, remote->ai_addrlen) == 0
+        && fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK) == 0;
+    freeaddrinfo(remote);
+
+    if(!ok) {
+        log_error("Couldn't open the UDP socket on port %u: %s", localPort, strerror(errno));
+        close(s);
+        return NULL;
+    }
+
+    UdpTransport *udp = malloc(sizeof(UdpTransport));
+    assert(udp != NULL && "Not enough memory");
+    udp->transport = (Transport){udp_send, udp_receive, udp_free};
+    udp->socket = s;
+    udp->failed = false;
+    return &udp->transport;
+}
+
+// FAKE LINK //
+static bool fake_send(Transport *transport, const uint8_t *data, size_t size) {
+    FakeEndpoint *endpoint = (FakeEndpoint*)transport;
+    FakeLink *link = endpoint->link;
+
+    if(rng_next(&link->rng) < link->lossThreshold) return true;
+
+    FakePacket packet = {.size = size, .deliverTime = link->time + link->latency};
+    memcpy(packet.data, data, size);
+    da_append(&link->queues[1 - endpoint->side], packet);
+    return true;
+}
+
+static size_t fake_receive(Transport *transport, uint8_t *buffer, size_t capacity) {
+    FakeEndpoint *endpoint = (FakeEndpoint*)transport;
+    FakeLink *link = endpoint->link;
+    FakeQueue *queue = &link->queues[endpoint->side];
+
+    // the latency is the same for every packet so they arrive in order
+    if(queue->head == queue->count || queue->items[queue->head].deliverTime > link->time) return 0;
+
+    FakePacket *packet = &queue->items[queue->head++];
+    size_t size = packet->size < capacity ? packet->size : capacity;
+    memcpy(buffer, packet->data, size);
+
+    if(queue->head == queue->count) {
+        queue->head = 0;
+        queue->count = 0;
+    }
+    return size;
+}
+
+static void fake_free(Transport *transport) {
+    // the link owns the endpoints
+}
+
+FakeLink *fake_link_create(uint64_t latency, double lossRate, uint64_t seed) {
+    FakeLink *link = calloc(1, sizeof(FakeLink));
+    assert(link != NULL && "Not enough memory");
+
+    for(int side = 0; side < 2; side++) {
+        link->endpoints[side] = (FakeEndpoint){
+            .transport = {fake_send, fake_receive, fake_free},
+            .link = link,
+            .side = side,
+        };
+    }
+
+    link->latency = latency;
+    link->lossThreshold = (lossRate < 0 ? 0 : lossRate > 1 ? 1 : lossRate) * UINT32_MAX;
+    rng_seed(&link->rng, seed, 0);
+    return link;
+}
+
+void fake_link_free(FakeLink *link) {
+    da_free(&link->queues[0]);
+    da_free(&link->queues[1]);
+    free(link);
+}
+
+Transport *fake_link_endpoint(FakeLink *link, int side) {
+    return &link->endpoints[side].transport;
+}
+
+void fake_link_step(FakeLink *link) {
+    link->time++;
+}
@@ -0,0 +1,66 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rng.h"
+
+#define TRANSPORT_MAX_PACKET 512 // bigger packets are dropped
+
+// an unreliable and unordered channel of packets to a single peer, the implementations embed it as their first field
+typedef struct Transport Transport;
+struct Transport {
+    bool (*send)(Transport *transport, const uint8_t *data, size_t size); // a sent packet can still be lost
+    size_t (*receive)(Transport *transport, uint8_t *buffer, size_t capacity); // returns 0 if there is no packet
+    void (*free)(Transport *transport);
+};
+
+bool transport_send(Transport *transport, const uint8_t *data, size_t size);
+size_t transport_receive(Transport *transport, uint8_t *buffer, size_t capacity); // never blocks
+void transport_free(Transport *transport);
+
+// a nonblocking UDP socket bound to localPort that only talks with remoteHost:remotePort, returns NULL on error
+Transport *udp_transport_create(uint16_t localPort, const char *remoteHost, uint16_t remotePort);
+
+typedef struct {
+    uint8_t data[TRANSPORT_MAX_PACKET];
+    size_t size;
+    uint64_t deliverTime; // the packet can be received once the link reaches this time
+} FakePacket;
+
+typedef struct {
+    FakePacket *items;
+    size_t head; // first packet not received
+    size_t count;
+    size_t capacity;
+} FakeQueue;
+
+typedef struct FakeLink FakeLink;
+
+typedef struct {
+    Transport transport;
+    FakeLink *link;
+    int side; // the packets are received from the queue of this side and sent to the other one
+} FakeEndpoint;
+
+// an in-process link between two endpoints with a fixed latency and random packet loss, the time of the link only
+// advances with fake_link_step so the tests are reproducible
+struct FakeLink {
+    FakeEndpoint endpoints[2];
+
+    FakeQueue queues[2]; // queues[i] has the packets going to the endpoint i
+
+    uint64_t time;
+    uint64_t latency; // steps until a packet can be received
+    uint32_t lossThreshold; // packets are lost when the rng is below this value
+    Rng rng;
+};
+
+FakeLink *fake_link_create(uint64_t latency, double lossRate, uint64_t seed);
+void fake_link_free(FakeLink *link); // the endpoints are owned by the link, transport_free does nothing on them
+Transport *fake_link_endpoint(FakeLink *link, int side); // side is 0 or 1
+void fake_link_step(FakeLink *link); // advances the time of the link by one step
+
+#endif // TRANSPORT_H
@@ -0,0 +1,42 @@
+#include "CCFuncs.h"
+#include "transposition.h"
+
+TranspositionTable *transposition_table_create(size_t entryCount) {
+    size_t count = 1;
+    while(count < entryCount) count *= 2;
+
+    TranspositionTable *table = malloc(sizeof(TranspositionTable));
+    assert(table != NULL && "Not enough memory");
+
+    // the zeroed entries have depth 0 so they only match searches that don't look at any move
+    table->entries = calloc(count, sizeof(TranspositionEntry));
+    assert(table->entries != NULL && "Not enough memory");
+    table->mask = count - 1;
+
+    return table;
+}
+
+void transposition_table_free(TranspositionTable *table) {
+    free(table->entries);
+    free(table);
+}
+
+void transposition_table_store(TranspositionTable *table, uint64_t hash, int depth, int value) {
+    TranspositionEntry *entry = &table->entries[hash & table->mask];
+    uint64_t data = (uint32_t)value | (uint64_t)(uint8_t)depth << 32;
+
+    atomic_store_explicit(&entry->key, hash ^ data, memory_order_relaxed);
+    atomic_store_explicit(&entry->data, data, memory_order_relaxed);
+}
+
+bool transposition_table_probe(TranspositionTable *table, uint64_t hash, int depth, int *value) {
+    TranspositionEntry *entry = &table->entries[hash & table->mask];
+    uint64_t key = atomic_load_explicit(&entry->key, memory_order_relaxed);
+    uint64_t data = atomic_load_explicit(&entry->data, memory_order_relaxed);
+
+    if((key ^ data) != hash) return false;
+    if((int)(data >> 32 & 0xff) < depth) return false;
+
+    *value = (int32_t)(uint32_t)data;
+    return true;
+}
@@ -0,0 +1,30 @@
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// NOTE: the entries are written without locks, the key is stored xored with the data so an entry torn by two
+// threads writing at the same time doesn't match any hash and it's treated as empty
+typedef struct {
+    _Atomic uint64_t key; // hash ^ data
+    _Atomic uint64_t data; // value in the low 32 bits, depth in the next 8
+} TranspositionEntry;
+
+// a fixed size table of search results shared by every thread, new results always replace the old ones
+typedef struct {
+    TranspositionEntry *entries;
+    size_t mask; // entry count - 1
+} TranspositionTable;
+
+// entryCount is rounded up to a power of two
+TranspositionTable *transposition_table_create(size_t entryCount);
+void transposition_table_free(TranspositionTable *table);
+
+void transposition_table_store(TranspositionTable *table, uint64_t hash, int depth, int value);
+// returns true if hash was searched with at least depth moves, the value of that search goes to value
+bool transposition_table_probe(TranspositionTable *table, uint64_t hash, int depth, int *value);
+
+#endif // TRANSPOSITION_H